@@ -0,0 +1,451 @@
+#define KG_IMPL
+#define KG_THREADS
+#define KG_THREADS_IMPL
+#include "kg.h"
+
+typedef struct bench_linear_map_t {
+    kg_allocator_t* allocator;
+    u64*            keys;
+    i64*            values;
+    u8*             used;
+    isize           cap;
+    isize           len;
+} bench_linear_map_t;
+
+b32 bench_linear_map_create(bench_linear_map_t* m, kg_allocator_t* a, isize cap) {
+    *m = (bench_linear_map_t){
+        .allocator = a,
+        .keys      = kg_allocator_alloc_array(a, u64, cap),
+        .values    = kg_allocator_alloc_array(a, i64, cap),
+        .used      = kg_allocator_alloc_array(a, u8, cap),
+        .cap       = cap,
+    };
+    return m->keys && m->values && m->used;
+}
+void bench_linear_map_destroy(bench_linear_map_t* m) {
+    kg_allocator_free(m->allocator, m->keys, kg_sizeof(u64) * m->cap);
+    kg_allocator_free(m->allocator, m->values, kg_sizeof(i64) * m->cap);
+    kg_allocator_free(m->allocator, m->used, m->cap);
+}
+b32 bench_linear_map_set(bench_linear_map_t* m, u64 key, i64 value);
+void bench_linear_map_grow(bench_linear_map_t* m) {
+    bench_linear_map_t grown;
+    bench_linear_map_create(&grown, m->allocator, m->cap * 2);
+    for (isize i = 0; i < m->cap; i++) {
+        if (m->used[i]) {
+            bench_linear_map_set(&grown, m->keys[i], m->values[i]);
+        }
+    }
+    bench_linear_map_destroy(m);
+    *m = grown;
+}
+b32 bench_linear_map_set(bench_linear_map_t* m, u64 key, i64 value) {
+    if ((m->len + 1) * 8 > m->cap * 7) {
+        bench_linear_map_grow(m);
+    }
+    isize mask = m->cap - 1;
+    for (isize i = kg_cast(isize)kg_hash_u64(key) & mask;; i = (i + 1) & mask) {
+        if (!m->used[i]) {
+            m->used[i] = true;
+            m->keys[i] = key;
+            m->values[i] = value;
+            m->len++;
+            return true;
+        }
+        if (m->keys[i] == key) {
+            m->values[i] = value;
+            return true;
+        }
+    }
+}
+i64* bench_linear_map_get(bench_linear_map_t* m, u64 key) {
+    isize mask = m->cap - 1;
+    for (isize i = kg_cast(isize)kg_hash_u64(key) & mask; m->used[i]; i = (i + 1) & mask) {
+        if (m->keys[i] == key) {
+            return &m->values[i];
+        }
+    }
+    return null;
+}
+
+kg_static kg_inline u64 bench_hash_u64(const u64 key) {
+    return kg_hash_u64(key);
+}
+kg_static kg_inline b32 bench_is_equal_u64(const u64 key, const u64 other) {
+    return key == other;
+}
+KG_MAP_TYPEDEF_FN(u64, i64, bench_u64, bench_hash_u64, bench_is_equal_u64)
+
+f64 bench_ns_per_op(kg_time_t start, isize ops) {
+    kg_duration_t d = kg_time_since(start);
+    return (kg_cast(f64)d.sec * 1e9 + kg_cast(f64)d.nsec) / kg_cast(f64)ops;
+}
+
+u64 bench_key(isize i) {
+    return kg_cast(u64)i * 0x9e3779b97f4a7c15ull;
+}
+
+void bench_map(isize n) {
+    kg_allocator_t allocator = kg_allocator_default();
+    i64 sink = 0;
+
+    bench_linear_map_t linear;
+    bench_linear_map_create(&linear, &allocator, KG_MAP_MIN_CAP);
+    kg_time_t start = kg_time_now();
+    for (isize i = 0; i < n; i++) {
+        bench_linear_map_set(&linear, bench_key(i), i);
+    }
+    f64 linear_insert = bench_ns_per_op(start, n);
+    start = kg_time_now();
+    for (isize i = 0; i < n; i++) {
+        sink += *bench_linear_map_get(&linear, bench_key(i));
+    }
+    f64 linear_hit = bench_ns_per_op(start, n);
+    start = kg_time_now();
+    for (isize i = 0; i < n; i++) {
+        sink += bench_linear_map_get(&linear, bench_key(n + i)) != null;
+    }
+    f64 linear_miss = bench_ns_per_op(start, n);
+    bench_linear_map_destroy(&linear);
+
+    kg_map_bench_u64_t swiss;
+    kg_map_bench_u64_create(&swiss, &allocator, 0);
+    start = kg_time_now();
+    for (isize i = 0; i < n; i++) {
+        kg_map_bench_u64_set(&swiss, bench_key(i), i);
+    }
+    f64 swiss_insert = bench_ns_per_op(start, n);
+    start = kg_time_now();
+    for (isize i = 0; i < n; i++) {
+        sink += *kg_map_bench_u64_get(&swiss, bench_key(i));
+    }
+    f64 swiss_hit = bench_ns_per_op(start, n);
+    start = kg_time_now();
+    for (isize i = 0; i < n; i++) {
+        sink += kg_map_bench_u64_get(&swiss, bench_key(n + i)) != null;
+    }
+    f64 swiss_miss = bench_ns_per_op(start, n);
+    start = kg_time_now();
+    for (isize i = 0; i < n; i++) {
+        kg_map_bench_u64_remove(&swiss, bench_key(i));
+        kg_map_bench_u64_set(&swiss, bench_key(n + i), i);
+    }
+    f64 swiss_churn = bench_ns_per_op(start, n);
+    kg_map_bench_u64_destroy(&swiss);
+
+    kg_printf("map n=%lli (ns/op)\n", n);
+    kg_printf("  %-16s %10s %10s %10s %10s\n", "", "insert", "hit", "miss", "churn");
+    kg_printf("  %-16s %10.1f %10.1f %10.1f %10s\n", "linear probing", linear_insert, linear_hit, linear_miss, "-");
+    kg_printf("  %-16s %10.1f %10.1f %10.1f %10.1f\n", "kg_map", swiss_insert, swiss_hit, swiss_miss, swiss_churn);
+    kg_printf("  (sink %lli)\n", sink);
+}
+
+#define BENCH_RING_CAP   1024
+#define BENCH_RING_BATCH 64
+
+typedef struct bench_ring_st_t {
+    kg_spsc_ring_t ring;
+    kg_queue_t     queue;
+    kg_mutex_t     mutex;
+    isize          n;
+} bench_ring_st_t;
+
+void* bench_spsc_push_producer_(void* arg) {
+    bench_ring_st_t* st = kg_cast(bench_ring_st_t*)arg;
+    u64 batch[BENCH_RING_BATCH];
+    for (isize i = 0; i < st->n;) {
+        isize n = kg_min(st->n - i, BENCH_RING_BATCH);
+        for (isize j = 0; j < n; j++) {
+            batch[j] = kg_cast(u64)(i + j);
+        }
+        isize pushed = 0;
+        while (pushed < n) {
+            isize m = kg_spsc_ring_push(&st->ring, batch + pushed, n - pushed);
+            if (m == 0) {
+                kg_thread_yield();
+            }
+            pushed += m;
+        }
+        i += n;
+    }
+    return null;
+}
+void* bench_spsc_acquire_producer_(void* arg) {
+    bench_ring_st_t* st = kg_cast(bench_ring_st_t*)arg;
+    for (isize i = 0; i < st->n;) {
+        isize n = kg_min(st->n - i, BENCH_RING_BATCH);
+        u64* span = kg_spsc_ring_write_acquire(&st->ring, &n);
+        for (isize j = 0; j < n; j++) {
+            span[j] = kg_cast(u64)(i + j);
+        }
+        if (n > 0) {
+            kg_spsc_ring_write_commit(&st->ring, n);
+            i += n;
+        } else {
+            kg_thread_yield();
+        }
+    }
+    return null;
+}
+void* bench_mutex_queue_producer_(void* arg) {
+    bench_ring_st_t* st = kg_cast(bench_ring_st_t*)arg;
+    for (isize i = 0; i < st->n;) {
+        kg_mutex_lock(&st->mutex);
+        isize n = kg_min(st->n - i, BENCH_RING_CAP - kg_queue_len(&st->queue));
+        n = kg_min(n, BENCH_RING_BATCH);
+        for (isize j = 0; j < n; j++) {
+            u64 v = kg_cast(u64)(i + j);
+            kg_queue_enqueue(&st->queue, &v);
+        }
+        kg_mutex_unlock(&st->mutex);
+        if (n == 0) {
+            kg_thread_yield();
+        }
+        i += n;
+    }
+    return null;
+}
+
+void bench_ring_report_(const char* name, kg_time_t start, isize n, u64 sum) {
+    kg_duration_t d = kg_time_since(start);
+    f64 sec = kg_cast(f64)d.sec + kg_cast(f64)d.nsec / 1e9;
+    u64 expected = kg_cast(u64)n * kg_cast(u64)(n - 1) / 2;
+    kg_printf("  %-24s %10.1f %10.1f %s\n", name, kg_cast(f64)n / sec / 1e6, kg_cast(f64)n * kg_sizeof(u64) / sec / 1e6, sum == expected ? "" : "(mismatch)");
+}
+
+void bench_ring(isize n) {
+    kg_allocator_t allocator = kg_allocator_default();
+    bench_ring_st_t st = {.n = n};
+    kg_thread_t producer;
+    u64 batch[BENCH_RING_BATCH];
+
+    kg_printf("ring n=%lli batch=%i cap=%i\n", n, BENCH_RING_BATCH, BENCH_RING_CAP);
+    kg_printf("  %-24s %10s %10s\n", "", "Mitems/s", "MB/s");
+
+    kg_spsc_ring_create(&st.ring, &allocator, kg_sizeof(u64), BENCH_RING_CAP);
+    u64 sum = 0;
+    kg_time_t start = kg_time_now();
+    kg_thread_create(&producer, bench_spsc_push_producer_, &st);
+    for (isize i = 0; i < n;) {
+        isize got = kg_spsc_ring_pop(&st.ring, batch, BENCH_RING_BATCH);
+        if (got == 0) {
+            kg_thread_yield();
+        }
+        for (isize j = 0; j < got; j++) {
+            sum += batch[j];
+        }
+        i += got;
+    }
+    kg_thread_join(&producer);
+    bench_ring_report_("spsc push/pop", start, n, sum);
+    kg_spsc_ring_destroy(&st.ring);
+
+    kg_spsc_ring_create(&st.ring, &allocator, kg_sizeof(u64), BENCH_RING_CAP);
+    sum = 0;
+    start = kg_time_now();
+    kg_thread_create(&producer, bench_spsc_acquire_producer_, &st);
+    for (isize i = 0; i < n;) {
+        isize got = BENCH_RING_BATCH;
+        const u64* span = kg_spsc_ring_read_acquire(&st.ring, &got);
+        for (isize j = 0; j < got; j++) {
+            sum += span[j];
+        }
+        if (got > 0) {
+            kg_spsc_ring_read_commit(&st.ring, got);
+            i += got;
+        } else {
+            kg_thread_yield();
+        }
+    }
+    kg_thread_join(&producer);
+    bench_ring_report_("spsc acquire/commit", start, n, sum);
+    kg_spsc_ring_destroy(&st.ring);
+
+    kg_queue_create(&st.queue, &allocator, kg_sizeof(u64), BENCH_RING_CAP);
+    kg_mutex_create(&st.mutex);
+    sum = 0;
+    start = kg_time_now();
+    kg_thread_create(&producer, bench_mutex_queue_producer_, &st);
+    for (isize i = 0; i < n;) {
+        kg_mutex_lock(&st.mutex);
+        isize got = 0;
+        while (got < BENCH_RING_BATCH && kg_queue_deque(&st.queue, &batch[got])) {
+            got++;
+        }
+        kg_mutex_unlock(&st.mutex);
+        if (got == 0) {
+            kg_thread_yield();
+        }
+        for (isize j = 0; j < got; j++) {
+            sum += batch[j];
+        }
+        i += got;
+    }
+    kg_thread_join(&producer);
+    bench_ring_report_("kg_queue_t + kg_mutex_t", start, n, sum);
+    kg_mutex_destroy(&st.mutex);
+    kg_queue_destroy(&st.queue);
+}
+
+void bench_sort_fill_(isize* values, isize n, isize kind) {
+    for (isize i = 0; i < n; i++) {
+        switch (kind) {
+            case 0: values[i] = kg_cast(isize)(kg_hash_u64(i) >> 34); break;
+            case 1: values[i] = i; break;
+            case 2: values[i] = n - i; break;
+            case 3: values[i] = kg_cast(isize)(kg_hash_u64(i) % 16); break;
+        }
+    }
+}
+
+void bench_sort(isize n) {
+    kg_allocator_t allocator = kg_allocator_default();
+    isize* values = kg_allocator_alloc_array(&allocator, isize, n);
+    const char* kinds[] = {"random", "sorted", "reversed", "16 unique"};
+    f64 results[3][4];
+    for (isize kind = 0; kind < 4; kind++) {
+        bench_sort_fill_(values, n, kind);
+        kg_time_t start = kg_time_now();
+        kg_quicksort(values, 0, n, kg_sizeof(isize), kg_isize_compare);
+        results[0][kind] = bench_ns_per_op(start, n);
+
+        bench_sort_fill_(values, n, kind);
+        start = kg_time_now();
+        qsort(values, n, kg_sizeof(isize), kg_isize_compare);
+        results[1][kind] = bench_ns_per_op(start, n);
+
+        bench_sort_fill_(values, n, kind);
+        start = kg_time_now();
+        kg_sort_isize(values, n);
+        results[2][kind] = bench_ns_per_op(start, n);
+        if (!kg_sort_isize_is_sorted(values, n)) {
+            kg_printf("kg_sort_isize failed on %s\n", kinds[kind]);
+        }
+    }
+    kg_allocator_free(&allocator, values, n * kg_sizeof(isize));
+
+    const char* names[] = {"kg_quicksort", "qsort", "kg_sort_isize"};
+    kg_printf("sort n=%lli isize (ns/element)\n", n);
+    kg_printf("  %-16s %10s %10s %10s %10s\n", "", kinds[0], kinds[1], kinds[2], kinds[3]);
+    for (isize i = 0; i < 3; i++) {
+        kg_printf("  %-16s %10.1f %10.1f %10.1f %10.1f\n", names[i], results[i][0], results[i][1], results[i][2], results[i][3]);
+    }
+}
+
+void bench_radix(isize n) {
+    kg_allocator_t allocator = kg_allocator_default();
+    u64* keys = kg_allocator_alloc_array(&allocator, u64, n);
+    f64* fkeys = kg_allocator_alloc_array(&allocator, f64, n);
+    f64 results[2][3];
+
+    for (isize i = 0; i < n; i++) { keys[i] = kg_hash_u64(i); }
+    kg_time_t start = kg_time_now();
+    kg_sort_u64(keys, n);
+    results[0][0] = bench_ns_per_op(start, n);
+    for (isize i = 0; i < n; i++) { keys[i] = kg_hash_u64(i); }
+    start = kg_time_now();
+    kg_radix_sort_u64(keys, null, n, &allocator);
+    results[1][0] = bench_ns_per_op(start, n);
+
+    for (isize i = 0; i < n; i++) { keys[i] = kg_hash_u64(i) >> 44; }
+    start = kg_time_now();
+    kg_sort_u64(keys, n);
+    results[0][1] = bench_ns_per_op(start, n);
+    for (isize i = 0; i < n; i++) { keys[i] = kg_hash_u64(i) >> 44; }
+    start = kg_time_now();
+    kg_radix_sort_u64(keys, null, n, &allocator);
+    results[1][1] = bench_ns_per_op(start, n);
+
+    for (isize i = 0; i < n; i++) { fkeys[i] = kg_cast(f64)kg_cast(i64)kg_hash_u64(i) / 1e9; }
+    start = kg_time_now();
+    kg_sort_f64(fkeys, n);
+    results[0][2] = bench_ns_per_op(start, n);
+    for (isize i = 0; i < n; i++) { fkeys[i] = kg_cast(f64)kg_cast(i64)kg_hash_u64(i) / 1e9; }
+    start = kg_time_now();
+    kg_radix_sort_f64(fkeys, null, n, &allocator);
+    results[1][2] = bench_ns_per_op(start, n);
+    if (!kg_sort_u64_is_sorted(keys, n) || !kg_sort_f64_is_sorted(fkeys, n)) {
+        kg_printf("kg_radix_sort failed\n");
+    }
+    kg_allocator_free(&allocator, keys, n * kg_sizeof(u64));
+    kg_allocator_free(&allocator, fkeys, n * kg_sizeof(f64));
+
+    kg_printf("radix n=%lli (ns/element)\n", n);
+    kg_printf("  %-16s %10s %10s %10s\n", "", "u64", "u64 20bit", "f64");
+    kg_printf("  %-16s %10.1f %10.1f %10.1f\n", "kg_sort", results[0][0], results[0][1], results[0][2]);
+    kg_printf("  %-16s %10.1f %10.1f %10.1f\n", "kg_radix_sort", results[1][0], results[1][1], results[1][2]);
+}
+
+KG_STABLE_SORT_TYPEDEF(i64, i64, kg_sort_less)
+
+void bench_stable_sort_fill_(i64* values, isize n, b32 nearly_sorted) {
+    for (isize i = 0; i < n; i++) {
+        values[i] = nearly_sorted ? i * 1000 + kg_cast(i64)(kg_hash_u64(i) % 3000) : kg_cast(i64)kg_hash_u64(i);
+    }
+}
+
+void bench_stable_sort(isize n) {
+    kg_allocator_t allocator = kg_allocator_default();
+    i64* values = kg_allocator_alloc_array(&allocator, i64, n);
+    f64 results[2][2];
+    for (isize kind = 0; kind < 2; kind++) {
+        bench_stable_sort_fill_(values, n, kind == 1);
+        kg_time_t start = kg_time_now();
+        kg_sort_i64(values, n);
+        results[0][kind] = bench_ns_per_op(start, n);
+
+        bench_stable_sort_fill_(values, n, kind == 1);
+        start = kg_time_now();
+        kg_stable_sort_i64(values, n, &allocator);
+        results[1][kind] = bench_ns_per_op(start, n);
+        if (!kg_sort_i64_is_sorted(values, n)) {
+            kg_printf("kg_stable_sort_i64 failed\n");
+        }
+    }
+    kg_allocator_free(&allocator, values, n * kg_sizeof(i64));
+
+    kg_printf("stable sort n=%lli i64 (ns/element)\n", n);
+    kg_printf("  %-16s %10s %14s\n", "", "random", "nearly sorted");
+    kg_printf("  %-16s %10.1f %14.1f\n", "kg_sort", results[0][0], results[0][1]);
+    kg_printf("  %-16s %10.1f %14.1f\n", "kg_stable_sort", results[1][0], results[1][1]);
+}
+
+KG_PARALLEL_SORT_TYPEDEF(i64, i64, kg_sort_less)
+
+void bench_parallel_sort(isize n, isize workers) {
+    kg_allocator_t allocator = kg_allocator_default();
+    i64* values = kg_allocator_alloc_array(&allocator, i64, n);
+    kg_pool_t p;
+    kg_pool_create(&p, &allocator, workers);
+
+    for (isize i = 0; i < n; i++) { values[i] = kg_cast(i64)kg_hash_u64(i); }
+    kg_time_t start = kg_time_now();
+    kg_sort_i64(values, n);
+    f64 serial = bench_ns_per_op(start, n);
+
+    for (isize i = 0; i < n; i++) { values[i] = kg_cast(i64)kg_hash_u64(i); }
+    start = kg_time_now();
+    kg_parallel_sort_i64(&p, &allocator, values, n);
+    f64 parallel = bench_ns_per_op(start, n);
+    if (!kg_sort_i64_is_sorted(values, n)) {
+        kg_printf("kg_parallel_sort_i64 failed\n");
+    }
+    kg_pool_join(&p);
+    kg_pool_destroy(&p);
+    kg_allocator_free(&allocator, values, n * kg_sizeof(i64));
+
+    kg_printf("parallel sort n=%lli workers=%lli cpus=%li (ns/element)\n", n, workers, sysconf(_SC_NPROCESSORS_ONLN));
+    kg_printf("  %-16s %10.1f\n", "kg_sort_i64", serial);
+    kg_printf("  %-16s %10.1f (x%.2f)\n", "parallel", parallel, serial / parallel);
+}
+
+i32 main(void) {
+    bench_map(kg_cast(isize)1 << 10);
+    bench_map(kg_cast(isize)1 << 20);
+    bench_ring(kg_cast(isize)1 << 22);
+    bench_sort(kg_cast(isize)1 << 20);
+    bench_radix(kg_cast(isize)1 << 20);
+    bench_parallel_sort(kg_cast(isize)1 << 22, 4);
+    bench_stable_sort(kg_cast(isize)1 << 20);
+    return 0;
+}
@@ -7,6 +7,10 @@
 #include <stdio.h>
 #include <time.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 typedef int8_t    i8;
 typedef int16_t   i16;
 typedef int32_t   i32;
@@ -80,6 +84,16 @@ typedef ptrdiff_t isize;
 #define kg_abs(x)              ((x) < 0 ? -(x) : (x))
 #define kg_is_within(x, i, j)  (((x) >= (i)) && ((x) <= (j)))
 #define kg_is_between(x, i, j) (((x) > (i)) && ((x) < (j)))
+#define kg_is_power_of_two(x)  (((x) > 0) && (((x) & ((x) - 1)) == 0))
+#define kg_align_up(x, a)      (((x) + ((a) - 1)) & ~((a) - 1))
+
+#define kg_atomic_load(p)           __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define kg_atomic_store(p, v)       __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define kg_atomic_fetch_add(p, v)   __atomic_fetch_add(p, v, __ATOMIC_ACQ_REL)
+#define kg_atomic_fetch_sub(p, v)   __atomic_fetch_sub(p, v, __ATOMIC_ACQ_REL)
+#define kg_atomic_cas(p, e, d)      __atomic_compare_exchange_n(p, e, d, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#define kg_atomic_load_relaxed(p)   __atomic_load_n(p, __ATOMIC_RELAXED)
+#define kg_atomic_fence()           __atomic_thread_fence(__ATOMIC_SEQ_CST)
 
 #define kg_kibibytes(x) (            (x) * (i64)1024)
 #define kg_mebibytes(x) (kg_kibibytes(x) * (i64)1024)
@@ -118,54 +132,258 @@ i32   kg_mem_compare   (const void* a, const void* b, isize size);
 void  kg_mem_swap      (void* a, void* b, isize size);
 void* kg_mem_move      (void* dest, const void* src, isize size);
 
+#define KG_VM_HUGE_PAGE_SIZE kg_mebibytes(2)
+
+isize kg_vm_page_size (void);
+void* kg_vm_alloc     (isize size);
+void* kg_vm_reserve   (isize size);
+void* kg_vm_remap     (void* ptr, isize old_size, isize new_size);
+b32   kg_vm_commit    (void* ptr, isize size);
+b32   kg_vm_decommit  (void* ptr, isize size);
+b32   kg_vm_huge_pages(void* ptr, isize size);
+void  kg_vm_release   (void* ptr, isize size);
+
 typedef struct kg_allocator_t kg_allocator_t;
 
+#define KG_DEFAULT_ALIGNMENT (2 * kg_sizeof(void*))
+#define KG_ARENA_COMMIT_SIZE kg_kibibytes(64)
+
+typedef enum kg_arena_kind_t {
+    KG_ARENA_KIND_FIXED   = 0, // one block of max_size from the allocator
+    KG_ARENA_KIND_CHAINED = 1, // new blocks of at least block_size are chained when full
+    KG_ARENA_KIND_VIRTUAL = 2, // max_size is reserved up front, pages are committed on demand
+} kg_arena_kind_t;
+
+typedef struct kg_arena_block_t kg_arena_block_t;
+
+typedef struct kg_arena_block_t {
+    kg_arena_block_t* prev;
+    isize             size;
+} kg_arena_block_t;
+
 typedef struct kg_arena_t {
-    kg_allocator_t* allocator;
-    isize           max_size;
-    isize           allocated_size;
-    void*           real_ptr;
+    kg_allocator_t*   allocator;
+    isize             max_size;
+    isize             allocated_size;
+    void*             real_ptr;
+    kg_arena_kind_t   kind;
+    kg_arena_block_t* block;
+    isize             block_size;
+    isize             prev_blocks_allocated;
+    isize             committed_size;
+    isize             dirty_size;
+    isize             released_start;
+    isize             released_end;
+    isize             resize_in_place_count;
+    isize             resize_copy_count;
 } kg_arena_t;
 
-b32   kg_arena_create   (kg_arena_t* a, kg_allocator_t* allocator, isize max_size);
-void* kg_arena_alloc    (kg_arena_t* a, isize size);
-isize kg_arena_allocated(const kg_arena_t* a);
-isize kg_arena_available(const kg_arena_t* a);
-isize kg_arena_mem_size (const kg_arena_t* a);
-void  kg_arena_reset    (kg_arena_t* a);
-void  kg_arena_destroy  (kg_arena_t* a);
+typedef struct kg_arena_temp_t {
+    kg_arena_t*       arena;
+    kg_arena_block_t* block;
+    isize             allocated_size;
+    isize             prev_blocks_allocated;
+} kg_arena_temp_t;
+
+b32   kg_arena_create        (kg_arena_t* a, kg_allocator_t* allocator, isize max_size);
+b32   kg_arena_create_chained(kg_arena_t* a, kg_allocator_t* allocator, isize block_size);
+b32   kg_arena_create_virtual(kg_arena_t* a, isize reserve_size);
+void* kg_arena_alloc         (kg_arena_t* a, isize size);
+void* kg_arena_alloc_uninit  (kg_arena_t* a, isize size);
+void* kg_arena_alloc_align   (kg_arena_t* a, isize size, isize align);
+void* kg_arena_resize        (kg_arena_t* a, void* ptr, isize old_size, isize new_size);
+isize kg_arena_allocated     (const kg_arena_t* a);
+isize kg_arena_available     (const kg_arena_t* a);
+isize kg_arena_mem_size      (const kg_arena_t* a);
+void  kg_arena_reset         (kg_arena_t* a);
+void  kg_arena_reset_no_zero (kg_arena_t* a);
+void  kg_arena_release       (kg_arena_t* a, isize keep_size);
+void  kg_arena_destroy       (kg_arena_t* a);
+
+kg_arena_temp_t kg_arena_temp_begin(kg_arena_t* a);
+void            kg_arena_temp_end  (kg_arena_temp_t t);
+
+typedef struct kg_object_pool_slab_t kg_object_pool_slab_t;
+
+typedef struct kg_object_pool_slab_t {
+    kg_object_pool_slab_t* next;
+    isize                  slots_len;
+} kg_object_pool_slab_t;
+
+typedef struct kg_object_pool_t {
+    kg_allocator_t*        allocator;
+    isize                  slot_size;
+    isize                  slots_per_slab;
+    kg_object_pool_slab_t* slabs;
+    kg_object_pool_slab_t* slab;
+    isize                  slab_used;
+    void*                  free_list;
+    isize                  slabs_len;
+    isize                  allocated_count;
+} kg_object_pool_t;
+
+b32   kg_object_pool_create      (kg_object_pool_t* p, kg_allocator_t* allocator, isize slot_size, isize slots_per_slab);
+void* kg_object_pool_alloc       (kg_object_pool_t* p);
+void* kg_object_pool_alloc_uninit(kg_object_pool_t* p);
+void  kg_object_pool_free        (kg_object_pool_t* p, void* ptr);
+void  kg_object_pool_reset       (kg_object_pool_t* p);
+void  kg_object_pool_release     (kg_object_pool_t* p);
+isize kg_object_pool_mem_size    (const kg_object_pool_t* p);
+void  kg_object_pool_destroy     (kg_object_pool_t* p);
+
+#define KG_HEAP_CLASSES_LEN    16
+#define KG_HEAP_CLASS_MAX_SIZE 4096
+#define KG_HEAP_SLAB_SIZE      kg_kibibytes(64)
+
+typedef struct kg_heap_large_t kg_heap_large_t;
+
+typedef struct kg_heap_large_t {
+    kg_heap_large_t* prev;
+    kg_heap_large_t* next;
+    isize            mem_size;
+    isize            _padding;
+} kg_heap_large_t;
+
+typedef struct kg_heap_t {
+    kg_allocator_t*  allocator;
+    kg_object_pool_t classes[KG_HEAP_CLASSES_LEN];
+    kg_heap_large_t* large;
+    isize            large_count;
+} kg_heap_t;
+
+b32   kg_heap_create      (kg_heap_t* h, kg_allocator_t* allocator);
+isize kg_heap_class_index (isize size);
+isize kg_heap_class_size  (isize class_index);
+void* kg_heap_alloc       (kg_heap_t* h, isize size);
+void* kg_heap_alloc_uninit(kg_heap_t* h, isize size);
+void  kg_heap_free        (kg_heap_t* h, void* ptr, isize size);
+void* kg_heap_resize      (kg_heap_t* h, void* ptr, isize old_size, isize new_size);
+void  kg_heap_reset       (kg_heap_t* h);
+void  kg_heap_release     (kg_heap_t* h);
+isize kg_heap_mem_size    (const kg_heap_t* h);
+void  kg_heap_destroy     (kg_heap_t* h);
+
+typedef struct kg_allocator_mmap_context_t {
+    b32   huge_pages;
+    isize mapped_size;
+    isize map_count;
+    isize remap_count;
+} kg_allocator_mmap_context_t;
+
+kg_allocator_t kg_allocator_default    (void);
+kg_allocator_t kg_allocator_temp       (kg_arena_t* a);
+kg_allocator_t kg_allocator_object_pool(kg_object_pool_t* p);
+kg_allocator_t kg_allocator_heap       (kg_heap_t* h);
+kg_allocator_t kg_allocator_mmap       (kg_allocator_mmap_context_t* ctx);
+#define KG_ALLOCATOR_TRACKING_HISTOGRAM_LEN 16
 
-kg_allocator_t kg_allocator_default (void);
-kg_allocator_t kg_allocator_temp    (kg_arena_t* a);
 typedef struct kg_allocator_tracking_context_t {
     const char*     name;
     kg_allocator_t* parent_allocator;
+    b32             quiet;
     isize           total_allocated;
     isize           total_freed;
     isize           current_allocated;
+    isize           peak_allocated;
     isize           alloc_count;
     isize           free_count;
     isize           resize_count;
+    isize           size_histogram[KG_ALLOCATOR_TRACKING_HISTOGRAM_LEN];
 } kg_allocator_tracking_context_t;
-void           kg_allocator_tracking_context_print(const kg_allocator_tracking_context_t ctx);
-kg_allocator_t kg_allocator_tracking(kg_allocator_tracking_context_t* ctx);
 
-void* kg_allocator_alloc   (kg_allocator_t* a, isize s);
-void  kg_allocator_free    (kg_allocator_t* a, void* ptr, isize s);
-void  kg_allocator_free_all(kg_allocator_t* a, b32 clear);
-void* kg_allocator_resize  (kg_allocator_t* a, void* ptr, isize old_size, isize new_size);
+typedef struct kg_allocator_tracking_snapshot_t {
+    isize total_allocated;
+    isize total_freed;
+    isize current_allocated;
+    isize peak_allocated;
+    isize alloc_count;
+    isize free_count;
+    isize resize_count;
+    isize size_histogram[KG_ALLOCATOR_TRACKING_HISTOGRAM_LEN];
+} kg_allocator_tracking_snapshot_t;
+
+void                             kg_allocator_tracking_context_print  (const kg_allocator_tracking_context_t ctx);
+kg_allocator_tracking_snapshot_t kg_allocator_tracking_snapshot       (const kg_allocator_tracking_context_t* ctx);
+isize                            kg_allocator_tracking_histogram_index(isize size);
+kg_allocator_t                   kg_allocator_tracking                (kg_allocator_tracking_context_t* ctx);
+
+#define KG_ALLOCATOR_PROFILE_SITES_LEN      512
+#define KG_ALLOCATOR_PROFILE_FREE_CHUNK_LEN 64
+
+typedef enum kg_allocator_profile_sort_t {
+    KG_ALLOCATOR_PROFILE_SORT_BYTES = 0, // hot spots by total bytes requested
+    KG_ALLOCATOR_PROFILE_SORT_COUNT = 1, // hot spots by alloc + resize calls
+    KG_ALLOCATOR_PROFILE_SORT_LIVE  = 2, // leaks by bytes still allocated
+} kg_allocator_profile_sort_t;
+
+typedef struct kg_allocator_profile_site_t {
+    const char* file;
+    isize       line;
+    isize       alloc_count;
+    isize       resize_count;
+    isize       free_count;
+    isize       total_allocated;
+    isize       live_count;
+    isize       live_allocated;
+} kg_allocator_profile_site_t;
+
+typedef struct kg_allocator_profile_context_t {
+    kg_allocator_t*             parent_allocator;
+    i32                         lock;
+    isize                       sites_len;
+    isize                       dropped_count;
+    u16                         table[2 * KG_ALLOCATOR_PROFILE_SITES_LEN];
+    kg_allocator_profile_site_t sites[KG_ALLOCATOR_PROFILE_SITES_LEN];
+} kg_allocator_profile_context_t;
+
+void           kg_allocator_profile_set_site (const char* file, isize line);
+void           kg_allocator_profile_push_site(const char* file, isize line);
+void*          kg_allocator_profile_pop_site (void* ptr);
+isize          kg_allocator_profile_sites    (kg_allocator_profile_context_t* ctx, kg_allocator_profile_site_t* out, isize out_cap, kg_allocator_profile_sort_t sort);
+void           kg_allocator_profile_report   (kg_allocator_profile_context_t* ctx, kg_allocator_profile_sort_t sort, isize limit);
+kg_allocator_t kg_allocator_profile          (kg_allocator_profile_context_t* ctx);
+
+void* kg_allocator_alloc       (kg_allocator_t* a, isize s);
+void* kg_allocator_alloc_uninit(kg_allocator_t* a, isize s);
+b32   kg_allocator_alloc_batch (kg_allocator_t* a, isize s, isize n, void** out_ptrs);
+void  kg_allocator_free        (kg_allocator_t* a, void* ptr, isize s);
+void  kg_allocator_free_batch  (kg_allocator_t* a, void** ptrs, isize n, isize s);
+void  kg_allocator_free_all    (kg_allocator_t* a, b32 clear);
+void* kg_allocator_resize      (kg_allocator_t* a, void* ptr, isize old_size, isize new_size);
+
+// With KG_ALLOCATOR_PROFILE defined every alloc and resize records its call site
+// for kg_allocator_profile. The string and darray entry points push the caller's site
+// for the whole call, so the allocations they make inside this library are charged to it.
+#ifdef KG_ALLOCATOR_PROFILE
+#define kg_allocator_profile_scope_(call)               (kg_allocator_profile_push_site(__FILE__, __LINE__), kg_allocator_profile_pop_site(call))
+#define kg_allocator_alloc(a, s)                        (kg_allocator_profile_set_site(__FILE__, __LINE__), kg_allocator_alloc(a, s))
+#define kg_allocator_alloc_uninit(a, s)                 (kg_allocator_profile_set_site(__FILE__, __LINE__), kg_allocator_alloc_uninit(a, s))
+#define kg_allocator_alloc_batch(a, s, n, out_ptrs)     (kg_allocator_profile_set_site(__FILE__, __LINE__), kg_allocator_alloc_batch(a, s, n, out_ptrs))
+#define kg_allocator_resize(a, ptr, old_size, new_size) (kg_allocator_profile_set_site(__FILE__, __LINE__), kg_allocator_resize(a, ptr, old_size, new_size))
+#endif
+
+#define kg_allocator_alloc_array(a, T, n) kg_cast(T*)kg_allocator_alloc(a, kg_sizeof(T) * (n))
 
-typedef void* (*kg_allocator_allocate_fn_t)(kg_allocator_t* a, isize size);
-typedef void  (*kg_allocator_free_fn_t)    (kg_allocator_t* a, void* ptr, isize size);
-typedef void  (*kg_allocator_free_all_fn_t)(kg_allocator_t* a, b32 clear);
-typedef void* (*kg_allocator_resize_fn_t)  (kg_allocator_t* a, void* ptr, isize old_size, isize new_size);
+typedef void* (*kg_allocator_allocate_fn_t)      (kg_allocator_t* a, isize size);
+typedef b32   (*kg_allocator_allocate_batch_fn_t)(kg_allocator_t* a, isize size, isize n, void** out_ptrs);
+typedef void  (*kg_allocator_free_fn_t)          (kg_allocator_t* a, void* ptr, isize size);
+typedef void  (*kg_allocator_free_batch_fn_t)    (kg_allocator_t* a, void** ptrs, isize n, isize size);
+typedef void  (*kg_allocator_free_all_fn_t)      (kg_allocator_t* a, b32 clear);
+typedef void* (*kg_allocator_resize_fn_t)        (kg_allocator_t* a, void* ptr, isize old_size, isize new_size);
 
+// alloc returns zeroed memory, alloc_uninit may skip the zeroing for callers that
+// overwrite the memory right away and falls back to alloc when it is not set.
+// alloc_batch fills out_ptrs with n zeroed blocks or allocates nothing, free_batch
+// releases n blocks of the same size. Both fall back to one call per block when not set.
 typedef struct kg_allocator_t {
     struct {
-        kg_allocator_allocate_fn_t alloc;
-        kg_allocator_free_fn_t     free;
-        kg_allocator_free_all_fn_t free_all;
-        kg_allocator_resize_fn_t   resize;
+        kg_allocator_allocate_fn_t       alloc;
+        kg_allocator_allocate_fn_t       alloc_uninit;
+        kg_allocator_allocate_batch_fn_t alloc_batch;
+        kg_allocator_free_fn_t           free;
+        kg_allocator_free_batch_fn_t     free_batch;
+        kg_allocator_free_all_fn_t       free_all;
+        kg_allocator_resize_fn_t         resize;
     } proc;
     void* context;
 } kg_allocator_t;
@@ -174,6 +392,337 @@ typedef i32 (*kg_compare_fn_t)(const void* a, const void* b);
 
 void kg_quicksort(void* src, isize lo, isize hi, isize stride, kg_compare_fn_t compare_fn);
 
+#define KG_SORT_INSERTION_THRESHOLD 24
+#define KG_SORT_NINTHER_THRESHOLD   128
+
+#define kg_sort_less(a, b) ((a) < (b))
+
+// Introsort with the comparison inlined, less(a, b) takes two T values and can be a macro.
+// Partitions below KG_SORT_INSERTION_THRESHOLD finish with insertion sort and a partition
+// that recurses deeper than 2 * log2(n) falls back to heapsort, so the worst case is O(n log n).
+#define KG_SORT_TYPEDEF(T, name, less) \
+    kg_static kg_inline void kg_sort_##name##_insertion(T* a, isize n) { \
+        for (isize i = 1; i < n; i++) { \
+            T v = a[i]; \
+            isize j = i; \
+            for (; j > 0 && less(v, a[j - 1]); j--) { \
+                a[j] = a[j - 1]; \
+            } \
+            a[j] = v; \
+        } \
+    } \
+    kg_static kg_inline void kg_sort_##name##_sift_down_(T* a, isize i, isize n) { \
+        T v = a[i]; \
+        for (isize child = 2 * i + 1; child < n; child = 2 * i + 1) { \
+            if (child + 1 < n && less(a[child], a[child + 1])) { \
+                child++; \
+            } \
+            if (!less(v, a[child])) { \
+                break; \
+            } \
+            a[i] = a[child]; \
+            i = child; \
+        } \
+        a[i] = v; \
+    } \
+    kg_static kg_inline void kg_sort_##name##_heap(T* a, isize n) { \
+        for (isize i = n / 2 - 1; i >= 0; i--) { \
+            kg_sort_##name##_sift_down_(a, i, n); \
+        } \
+        for (isize i = n - 1; i > 0; i--) { \
+            T t = a[0]; a[0] = a[i]; a[i] = t; \
+            kg_sort_##name##_sift_down_(a, 0, i); \
+        } \
+    } \
+    kg_static kg_inline isize kg_sort_##name##_median3_(const T* a, isize i, isize j, isize k) { \
+        return less(a[i], a[j]) \
+            ? (less(a[j], a[k]) ? j : (less(a[i], a[k]) ? k : i)) \
+            : (less(a[k], a[j]) ? j : (less(a[k], a[i]) ? k : i)); \
+    } \
+    kg_static void kg_sort_##name##_intro_(T* a, isize n, isize depth) { \
+        while (n > KG_SORT_INSERTION_THRESHOLD) { \
+            if (depth-- == 0) { \
+                kg_sort_##name##_heap(a, n); \
+                return; \
+            } \
+            isize m = n / 2; \
+            isize p = 0; \
+            if (n > KG_SORT_NINTHER_THRESHOLD) { \
+                isize s = n / 8; \
+                p = kg_sort_##name##_median3_(a, \
+                    kg_sort_##name##_median3_(a, 0, s, 2 * s), \
+                    kg_sort_##name##_median3_(a, m - s, m, m + s), \
+                    kg_sort_##name##_median3_(a, n - 1 - 2 * s, n - 1 - s, n - 1)); \
+            } else { \
+                p = kg_sort_##name##_median3_(a, 0, m, n - 1); \
+            } \
+            T pivot = a[p]; a[p] = a[0]; a[0] = pivot; \
+            isize i = 0; \
+            isize j = n; \
+            for (;;) { \
+                do { i++; } while (i < n && less(a[i], pivot)); \
+                do { j--; } while (less(pivot, a[j])); \
+                if (i >= j) { \
+                    break; \
+                } \
+                T t = a[i]; a[i] = a[j]; a[j] = t; \
+            } \
+            a[0] = a[j]; a[j] = pivot; \
+            if (j < n - 1 - j) { \
+                kg_sort_##name##_intro_(a, j, depth); \
+                a += j + 1; \
+                n -= j + 1; \
+            } else { \
+                kg_sort_##name##_intro_(a + j + 1, n - 1 - j, depth); \
+                n = j; \
+            } \
+        } \
+        kg_sort_##name##_insertion(a, n); \
+    } \
+    kg_static kg_inline void kg_sort_##name(T* a, isize n) { \
+        if (a && n > 1) { \
+            kg_sort_##name##_intro_(a, n, 2 * (63 - __builtin_clzll(kg_cast(u64)n))); \
+        } \
+    } \
+    kg_static kg_inline b32 kg_sort_##name##_is_sorted(const T* a, isize n) { \
+        for (isize i = 1; i < n; i++) { \
+            if (less(a[i], a[i - 1])) { \
+                return false; \
+            } \
+        } \
+        return true; \
+    }
+
+KG_SORT_TYPEDEF(i32, i32, kg_sort_less)
+KG_SORT_TYPEDEF(u32, u32, kg_sort_less)
+KG_SORT_TYPEDEF(i64, i64, kg_sort_less)
+KG_SORT_TYPEDEF(u64, u64, kg_sort_less)
+KG_SORT_TYPEDEF(isize, isize, kg_sort_less)
+KG_SORT_TYPEDEF(f32, f32, kg_sort_less)
+KG_SORT_TYPEDEF(f64, f64, kg_sort_less)
+
+#define KG_STABLE_SORT_MIN_MERGE  64
+#define KG_STABLE_SORT_MIN_GALLOP 7
+#define KG_STABLE_SORT_STACK_LEN  96
+
+// Stable adaptive merge sort in the TimSort scheme: natural runs are detected (strictly
+// descending ones reversed), short runs are extended with binary insertion sort, and
+// runs are merged under the usual stack invariants. Merges trim the parts already in
+// place and gallop through long winning streaks, so presorted input costs about O(n).
+// The scratch allocator provides a buffer of n / 2 elements, small inputs need none.
+#define KG_STABLE_SORT_TYPEDEF(T, name, less) \
+    typedef struct kg_stable_sort_##name##_state_t { \
+        T*    a; \
+        T*    tmp; \
+        isize min_gallop; \
+        isize runs_len; \
+        isize run_base[KG_STABLE_SORT_STACK_LEN]; \
+        isize run_len[KG_STABLE_SORT_STACK_LEN]; \
+    } kg_stable_sort_##name##_state_t; \
+    /* Number of elements in s that are <= key. */ \
+    kg_static kg_inline isize kg_stable_sort_##name##_gallop_right_(T key, const T* s, isize len) { \
+        isize lo = 0; \
+        isize hi = 1; \
+        while (hi < len && !less(key, s[hi - 1])) { \
+            lo = hi; \
+            hi = hi * 2 + 1; \
+        } \
+        hi = kg_min(hi, len); \
+        while (lo < hi) { \
+            isize mid = lo + (hi - lo) / 2; \
+            if (less(key, s[mid])) { hi = mid; } else { lo = mid + 1; } \
+        } \
+        return lo; \
+    } \
+    /* Number of elements in s that are < key. */ \
+    kg_static kg_inline isize kg_stable_sort_##name##_gallop_left_(T key, const T* s, isize len) { \
+        isize lo = 0; \
+        isize hi = 1; \
+        while (hi < len && less(s[hi - 1], key)) { \
+            lo = hi; \
+            hi = hi * 2 + 1; \
+        } \
+        hi = kg_min(hi, len); \
+        while (lo < hi) { \
+            isize mid = lo + (hi - lo) / 2; \
+            if (less(s[mid], key)) { lo = mid + 1; } else { hi = mid; } \
+        } \
+        return lo; \
+    } \
+    kg_static kg_inline void kg_stable_sort_##name##_binary_insertion_(T* a, isize sorted, isize n) { \
+        for (isize i = kg_max(sorted, 1); i < n; i++) { \
+            T v = a[i]; \
+            isize pos = kg_stable_sort_##name##_gallop_right_(v, a, i); \
+            kg_mem_move(a + pos + 1, a + pos, (i - pos) * kg_sizeof(T)); \
+            a[pos] = v; \
+        } \
+    } \
+    kg_static kg_inline isize kg_stable_sort_##name##_count_run_(T* a, isize n) { \
+        isize i = 1; \
+        if (n < 2) { \
+            return n; \
+        } \
+        if (less(a[1], a[0])) { \
+            while (i + 1 < n && less(a[i + 1], a[i])) { i++; } \
+            for (isize lo = 0, hi = i; lo < hi; lo++, hi--) { \
+                T t = a[lo]; a[lo] = a[hi]; a[hi] = t; \
+            } \
+        } else { \
+            while (i + 1 < n && !less(a[i + 1], a[i])) { i++; } \
+        } \
+        return i + 1; \
+    } \
+    kg_static void kg_stable_sort_##name##_merge_lo_(kg_stable_sort_##name##_state_t* st, T* a, isize a_len, T* b, isize b_len) { \
+        T* tmp = st->tmp; \
+        kg_mem_copy(tmp, a, a_len * kg_sizeof(T)); \
+        isize i = 0, j = 0, k = 0; \
+        isize a_wins = 0, b_wins = 0; \
+        while (i < a_len && j < b_len) { \
+            if (less(b[j], tmp[i])) { \
+                a[k++] = b[j++]; \
+                b_wins++; \
+                a_wins = 0; \
+            } else { \
+                a[k++] = tmp[i++]; \
+                a_wins++; \
+                b_wins = 0; \
+            } \
+            if (a_wins >= st->min_gallop && j < b_len) { \
+                isize c = kg_stable_sort_##name##_gallop_right_(b[j], tmp + i, a_len - i); \
+                kg_mem_copy(a + k, tmp + i, c * kg_sizeof(T)); \
+                i += c; k += c; a_wins = 0; \
+                st->min_gallop += c < KG_STABLE_SORT_MIN_GALLOP ? 1 : -(st->min_gallop > 1); \
+            } else if (b_wins >= st->min_gallop && i < a_len) { \
+                isize c = kg_stable_sort_##name##_gallop_left_(tmp[i], b + j, b_len - j); \
+                kg_mem_move(a + k, b + j, c * kg_sizeof(T)); \
+                j += c; k += c; b_wins = 0; \
+                st->min_gallop += c < KG_STABLE_SORT_MIN_GALLOP ? 1 : -(st->min_gallop > 1); \
+            } \
+        } \
+        kg_mem_copy(a + k, tmp + i, (a_len - i) * kg_sizeof(T)); \
+    } \
+    kg_static void kg_stable_sort_##name##_merge_hi_(kg_stable_sort_##name##_state_t* st, T* a, isize a_len, T* b, isize b_len) { \
+        T* tmp = st->tmp; \
+        kg_mem_copy(tmp, b, b_len * kg_sizeof(T)); \
+        isize i = a_len - 1, j = b_len - 1, k = a_len + b_len - 1; \
+        isize a_wins = 0, b_wins = 0; \
+        while (i >= 0 && j >= 0) { \
+            if (less(tmp[j], a[i])) { \
+                a[k--] = a[i--]; \
+                a_wins++; \
+                b_wins = 0; \
+            } else { \
+                a[k--] = tmp[j--]; \
+                b_wins++; \
+                a_wins = 0; \
+            } \
+            if (a_wins >= st->min_gallop && j >= 0) { \
+                isize c = i + 1 - kg_stable_sort_##name##_gallop_right_(tmp[j], a, i + 1); \
+                kg_mem_move(a + k - c + 1, a + i - c + 1, c * kg_sizeof(T)); \
+                i -= c; k -= c; a_wins = 0; \
+                st->min_gallop += c < KG_STABLE_SORT_MIN_GALLOP ? 1 : -(st->min_gallop > 1); \
+            } else if (b_wins >= st->min_gallop && i >= 0) { \
+                isize c = j + 1 - kg_stable_sort_##name##_gallop_left_(a[i], tmp, j + 1); \
+                kg_mem_copy(a + k - c + 1, tmp + j - c + 1, c * kg_sizeof(T)); \
+                j -= c; k -= c; b_wins = 0; \
+                st->min_gallop += c < KG_STABLE_SORT_MIN_GALLOP ? 1 : -(st->min_gallop > 1); \
+            } \
+        } \
+        kg_mem_copy(a, tmp, (j + 1) * kg_sizeof(T)); \
+    } \
+    kg_static void kg_stable_sort_##name##_merge_at_(kg_stable_sort_##name##_state_t* st, isize r) { \
+        T* a = st->a + st->run_base[r]; \
+        isize a_len = st->run_len[r]; \
+        T* b = st->a + st->run_base[r + 1]; \
+        isize b_len = st->run_len[r + 1]; \
+        st->run_len[r] = a_len + b_len; \
+        for (isize i = r + 1; i + 1 < st->runs_len; i++) { \
+            st->run_base[i] = st->run_base[i + 1]; \
+            st->run_len[i] = st->run_len[i + 1]; \
+        } \
+        st->runs_len--; \
+        isize skip = kg_stable_sort_##name##_gallop_right_(b[0], a, a_len); \
+        a += skip; \
+        a_len -= skip; \
+        if (a_len > 0) { \
+            b_len = kg_stable_sort_##name##_gallop_left_(a[a_len - 1], b, b_len); \
+            if (b_len > 0) { \
+                if (a_len <= b_len) { \
+                    kg_stable_sort_##name##_merge_lo_(st, a, a_len, b, b_len); \
+                } else { \
+                    kg_stable_sort_##name##_merge_hi_(st, a, a_len, b, b_len); \
+                } \
+            } \
+        } \
+    } \
+    kg_static kg_inline void kg_stable_sort_##name##_collapse_(kg_stable_sort_##name##_state_t* st) { \
+        isize* len = st->run_len; \
+        while (st->runs_len > 1) { \
+            isize r = st->runs_len - 2; \
+            if ((r > 0 && len[r - 1] <= len[r] + len[r + 1]) || (r > 1 && len[r - 2] <= len[r - 1] + len[r])) { \
+                if (len[r - 1] < len[r + 1]) { r--; } \
+            } else if (len[r] > len[r + 1]) { \
+                break; \
+            } \
+            kg_stable_sort_##name##_merge_at_(st, r); \
+        } \
+    } \
+    kg_static kg_inline b32 kg_stable_sort_##name(T* a, isize n, kg_allocator_t* scratch) { \
+        if (!a || n < 2) { \
+            return true; \
+        } \
+        if (n < KG_STABLE_SORT_MIN_MERGE) { \
+            kg_stable_sort_##name##_binary_insertion_(a, kg_stable_sort_##name##_count_run_(a, n), n); \
+            return true; \
+        } \
+        isize tmp_len = n / 2 + 1; \
+        kg_stable_sort_##name##_state_t st = { \
+            .a          = a, \
+            .tmp        = kg_allocator_alloc_uninit(scratch, tmp_len * kg_sizeof(T)), \
+            .min_gallop = KG_STABLE_SORT_MIN_GALLOP, \
+        }; \
+        if (!st.tmp) { \
+            return false; \
+        } \
+        isize min_run = n; \
+        isize odd = 0; \
+        while (min_run >= KG_STABLE_SORT_MIN_MERGE) { \
+            odd |= min_run & 1; \
+            min_run >>= 1; \
+        } \
+        min_run += odd; \
+        for (isize lo = 0; lo < n;) { \
+            isize run = kg_stable_sort_##name##_count_run_(a + lo, n - lo); \
+            if (run < min_run) { \
+                isize forced = kg_min(min_run, n - lo); \
+                kg_stable_sort_##name##_binary_insertion_(a + lo, run, forced); \
+                run = forced; \
+            } \
+            st.run_base[st.runs_len] = lo; \
+            st.run_len[st.runs_len] = run; \
+            st.runs_len++; \
+            kg_stable_sort_##name##_collapse_(&st); \
+            lo += run; \
+        } \
+        while (st.runs_len > 1) { \
+            isize r = st.runs_len - 2; \
+            if (r > 0 && st.run_len[r - 1] < st.run_len[r + 1]) { r--; } \
+            kg_stable_sort_##name##_merge_at_(&st, r); \
+        } \
+        kg_allocator_free(scratch, st.tmp, tmp_len * kg_sizeof(T)); \
+        return true; \
+    }
+
+// LSD radix sorts over 8 bit digits, signed and float keys are mapped to order preserving
+// unsigned bits for the passes and mapped back after. values is optional, when given it is
+// permuted together with the keys (stable). Scratch buffers come from the scratch allocator.
+b32 kg_radix_sort_u32(u32* keys, isize* values, isize n, kg_allocator_t* scratch);
+b32 kg_radix_sort_i32(i32* keys, isize* values, isize n, kg_allocator_t* scratch);
+b32 kg_radix_sort_f32(f32* keys, isize* values, isize n, kg_allocator_t* scratch);
+b32 kg_radix_sort_u64(u64* keys, isize* values, isize n, kg_allocator_t* scratch);
+b32 kg_radix_sort_i64(i64* keys, isize* values, isize n, kg_allocator_t* scratch);
+b32 kg_radix_sort_f64(f64* keys, isize* values, isize n, kg_allocator_t* scratch);
+
 i32   kg_cstr_compare     (const void* a, const void* b);
 i32   kg_cstr_compare_n   (const void* a, const void* b, isize n);
 i32   kg_cstr_compare_ci  (const void* a, const void* b);
@@ -229,6 +778,28 @@ u32         kg_string_utf8_len_n      (const kg_string_t s, isize n);
 void        kg_string_reset           (kg_string_t s);
 void        kg_string_destroy         (kg_string_t s);
 
+#ifdef KG_ALLOCATOR_PROFILE
+#define kg_string_create(a, cap)                 kg_allocator_profile_scope_(kg_string_create(a, cap))
+#define kg_string_from_unsafe(a, v, v_len)       kg_allocator_profile_scope_(kg_string_from_unsafe(a, v, v_len))
+#define kg_string_from_fmt(a, ...)               kg_allocator_profile_scope_(kg_string_from_fmt(a, __VA_ARGS__))
+#define kg_string_from_fmt_v(a, fmt, args)       kg_allocator_profile_scope_(kg_string_from_fmt_v(a, fmt, args))
+#define kg_string_from_str(a, s)                 kg_allocator_profile_scope_(kg_string_from_str(a, s))
+#define kg_string_from_str_n(a, s, n)            kg_allocator_profile_scope_(kg_string_from_str_n(a, s, n))
+#define kg_string_from_cstr(a, cstr)             kg_allocator_profile_scope_(kg_string_from_cstr(a, cstr))
+#define kg_string_from_cstr_n(a, cstr, cstr_len) kg_allocator_profile_scope_(kg_string_from_cstr_n(a, cstr, cstr_len))
+#define kg_string_set(s, cstr)                   kg_allocator_profile_scope_(kg_string_set(s, cstr))
+#define kg_string_append(s, other)               kg_allocator_profile_scope_(kg_string_append(s, other))
+#define kg_string_append_unsafe(s, v, v_len)     kg_allocator_profile_scope_(kg_string_append_unsafe(s, v, v_len))
+#define kg_string_append_fmt(s, ...)             kg_allocator_profile_scope_(kg_string_append_fmt(s, __VA_ARGS__))
+#define kg_string_append_fmt_v(s, fmt, args)     kg_allocator_profile_scope_(kg_string_append_fmt_v(s, fmt, args))
+#define kg_string_append_char(s, c)              kg_allocator_profile_scope_(kg_string_append_char(s, c))
+#define kg_string_append_rune(s, r)              kg_allocator_profile_scope_(kg_string_append_rune(s, r))
+#define kg_string_append_cstr(s, cstr)           kg_allocator_profile_scope_(kg_string_append_cstr(s, cstr))
+#define kg_string_append_cstr_n(s, cstr, n)      kg_allocator_profile_scope_(kg_string_append_cstr_n(s, cstr, n))
+#define kg_string_grow(s, n)                     kg_allocator_profile_scope_(kg_string_grow(s, n))
+#define kg_string_ensure_available(s, n)         kg_allocator_profile_scope_(kg_string_ensure_available(s, n))
+#endif
+
 typedef struct kg_str_t {
     isize       len;
     const char* ptr;
@@ -255,6 +826,7 @@ b32      kg_str_is_null            (const kg_str_t s);
 b32      kg_str_is_null_or_empty   (const kg_str_t s);
 b32      kg_str_is_valid_cstr      (const kg_str_t s);
 b32      kg_str_is_equal           (const kg_str_t s, const kg_str_t other);
+u64      kg_str_hash               (const kg_str_t s);
 b32      kg_str_contains           (const kg_str_t s, const kg_str_t needle);
 b32      kg_str_has_prefix         (const kg_str_t s, const kg_str_t prefix);
 b32      kg_str_has_suffix         (const kg_str_t s, const kg_str_t suffix);
@@ -340,6 +912,15 @@ void* kg_darray_grow2_            (kg_darray_base_t* b, isize n, void** out_ptr)
 void* kg_darray_grow_formula2_    (kg_darray_base_t* b, isize n, void** out_ptr);
 void* kg_darray_ensure_available2_(kg_darray_base_t* b, isize n, void** out_ptr);
 
+// The typed darray functions are generated by KG_DARRAY_TYPEDEF, so under
+// KG_ALLOCATOR_PROFILE their allocations are charged to the line that expanded it.
+#ifdef KG_ALLOCATOR_PROFILE
+#define kg_darray_create2_(a, stride, cap, out_b)    kg_allocator_profile_scope_(kg_darray_create2_(a, stride, cap, out_b))
+#define kg_darray_grow2_(b, n, out_ptr)              kg_allocator_profile_scope_(kg_darray_grow2_(b, n, out_ptr))
+#define kg_darray_grow_formula2_(b, n, out_ptr)      kg_allocator_profile_scope_(kg_darray_grow_formula2_(b, n, out_ptr))
+#define kg_darray_ensure_available2_(b, n, out_ptr)  kg_allocator_profile_scope_(kg_darray_ensure_available2_(b, n, out_ptr))
+#endif
+
 #define KG_DARRAY_TYPEDEF(T, name) \
     typedef struct kg_darray_##name##_t { \
         kg_darray_base_t base; \
@@ -376,6 +957,61 @@ void* kg_darray_ensure_available2_(kg_darray_base_t* b, isize n, void** out_ptr)
     kg_static kg_inline b32 kg_darray_##name##_grow_formula(kg_darray_##name##_t* d, isize n) { \
         return null != kg_darray_grow_formula2_(&d->base, n, kg_cast(void**)&d->ptr); \
     } \
+    kg_static kg_inline b32 kg_darray_##name##_reserve(kg_darray_##name##_t* d, isize cap) { \
+        return cap <= d->base.cap || null != kg_darray_grow2_(&d->base, cap - d->base.cap, kg_cast(void**)&d->ptr); \
+    } \
+    kg_static kg_inline b32 kg_darray_##name##_shrink(kg_darray_##name##_t* d) { \
+        isize cap = kg_max(d->base.len, 1); \
+        if (cap < d->base.cap) { \
+            T* ptr = kg_allocator_resize(d->base.allocator, d->ptr, d->base.cap * kg_sizeof(T), cap * kg_sizeof(T)); \
+            if (!ptr) { \
+                return false; \
+            } \
+            d->ptr = ptr; \
+            d->base.cap = cap; \
+        } \
+        return true; \
+    } \
+    kg_static kg_inline void kg_darray_##name##_clear(kg_darray_##name##_t* d) { \
+        d->base.len = 0; \
+    } \
+    kg_static kg_inline isize kg_darray_##name##_alias_index_(const kg_darray_##name##_t* d, const T* src) { \
+        usize at = kg_cast(usize)src - kg_cast(usize)d->ptr; \
+        return d->ptr && at < kg_cast(usize)(d->base.cap * kg_sizeof(T)) ? kg_cast(isize)(at / kg_sizeof(T)) : -1; \
+    } \
+    kg_static kg_inline b32 kg_darray_##name##_append_n(kg_darray_##name##_t* d, const T* src, isize n) { \
+        isize src_i = kg_darray_##name##_alias_index_(d, src); \
+        if (n >= 0 && kg_darray_ensure_available2_(&d->base, n, kg_cast(void**)&d->ptr)) { \
+            kg_mem_copy(d->ptr + d->base.len, src_i < 0 ? src : d->ptr + src_i, n * kg_sizeof(T)); \
+            d->base.len += n; \
+            return true; \
+        } \
+        return false; \
+    } \
+    kg_static kg_inline b32 kg_darray_##name##_insert_n(kg_darray_##name##_t* d, isize i, const T* src, isize n) { \
+        isize src_i = kg_darray_##name##_alias_index_(d, src); \
+        if (n >= 0 && kg_is_within(i, 0, d->base.len) && kg_darray_ensure_available2_(&d->base, n, kg_cast(void**)&d->ptr)) { \
+            kg_mem_move(d->ptr + i + n, d->ptr + i, (d->base.len - i) * kg_sizeof(T)); \
+            if (src_i < 0) { \
+                kg_mem_copy(d->ptr + i, src, n * kg_sizeof(T)); \
+            } else { \
+                isize head = kg_clamp(i - src_i, 0, n); \
+                kg_mem_copy(d->ptr + i, d->ptr + src_i, head * kg_sizeof(T)); \
+                kg_mem_copy(d->ptr + i + head, d->ptr + src_i + head + n, (n - head) * kg_sizeof(T)); \
+            } \
+            d->base.len += n; \
+            return true; \
+        } \
+        return false; \
+    } \
+    kg_static kg_inline b32 kg_darray_##name##_remove_range(kg_darray_##name##_t* d, isize i, isize n) { \
+        if (n >= 0 && i >= 0 && i + n <= d->base.len) { \
+            kg_mem_move(d->ptr + i, d->ptr + i + n, (d->base.len - i - n) * kg_sizeof(T)); \
+            d->base.len -= n; \
+            return true; \
+        } \
+        return false; \
+    } \
     kg_static kg_inline b32 kg_darray_##name##_pop(kg_darray_##name##_t* d) { \
         if (d->base.len > 0) { \
             d->base.len--; \
@@ -421,6 +1057,221 @@ KG_DARRAY_TYPEDEF(char, char)
 KG_DARRAY_TYPEDEF(const char*, cstr)
 KG_DARRAY_TYPEDEF(const void*, void)
 
+#define KG_SOA_COLUMN_ALIGN 64
+
+#define KG_SOA_ROW_FIELD_(T, f)    T f;
+#define KG_SOA_COLUMN_FIELD_(T, f) T* f;
+#define KG_SOA_MEM_SIZE_(T, f)     out_size = kg_align_up(out_size, KG_SOA_COLUMN_ALIGN) + cap * kg_sizeof(T);
+#define KG_SOA_PLACE_(T, f) \
+    offset = kg_cast(isize)(kg_align_up(kg_cast(usize)next.mem + offset, KG_SOA_COLUMN_ALIGN) - kg_cast(usize)next.mem); \
+    next.f = kg_cast(T*)(next.mem + offset); \
+    if (s->len > 0) { kg_mem_copy(next.f, s->f, s->len * kg_sizeof(T)); } \
+    offset += cap * kg_sizeof(T);
+#define KG_SOA_SET_(T, f)          s->f[i] = row.f;
+#define KG_SOA_GET_(T, f)          out.f = s->f[i];
+#define KG_SOA_MOVE_(T, f)         s->f[i] = s->f[s->len - 1];
+
+// Struct of arrays over an X-macro field list, e.g.
+//     #define PARTICLE_FIELDS(X) X(f32, x) X(f32, y) X(u32, id)
+//     KG_SOA_TYPEDEF(particle, PARTICLE_FIELDS)
+// Every field gets its own column, all columns live in one allocation and grow together.
+// The allocation is padded so each column starts on a KG_SOA_COLUMN_ALIGN byte address.
+// Rows go in and out through kg_soa_##name##_row_t, kernels read s.x, s.y directly.
+#define KG_SOA_TYPEDEF(name, FIELDS) \
+    typedef struct kg_soa_##name##_row_t { \
+        FIELDS(KG_SOA_ROW_FIELD_) \
+    } kg_soa_##name##_row_t; \
+    typedef struct kg_soa_##name##_t { \
+        kg_allocator_t* allocator; \
+        u8*             mem; \
+        isize           len; \
+        isize           cap; \
+        FIELDS(KG_SOA_COLUMN_FIELD_) \
+    } kg_soa_##name##_t; \
+    kg_static kg_inline isize kg_soa_##name##_mem_size_for(isize cap) { \
+        isize out_size = 0; \
+        FIELDS(KG_SOA_MEM_SIZE_) \
+        return out_size + KG_SOA_COLUMN_ALIGN - 1; \
+    } \
+    kg_static kg_inline b32 kg_soa_##name##_reserve(kg_soa_##name##_t* s, isize cap) { \
+        if (cap <= s->cap) { \
+            return true; \
+        } \
+        kg_soa_##name##_t next = *s; \
+        next.mem = kg_allocator_alloc_uninit(s->allocator, kg_soa_##name##_mem_size_for(cap)); \
+        if (!next.mem) { \
+            return false; \
+        } \
+        isize offset = 0; \
+        FIELDS(KG_SOA_PLACE_) \
+        if (s->mem) { \
+            kg_allocator_free(s->allocator, s->mem, kg_soa_##name##_mem_size_for(s->cap)); \
+        } \
+        next.cap = cap; \
+        *s = next; \
+        return true; \
+    } \
+    kg_static kg_inline kg_soa_##name##_t kg_soa_##name##_create(kg_allocator_t* a, isize cap) { \
+        kg_soa_##name##_t out = {0}; \
+        out.allocator = a; \
+        kg_soa_##name##_reserve(&out, cap); \
+        return out; \
+    } \
+    kg_static kg_inline b32 kg_soa_##name##_append(kg_soa_##name##_t* s, kg_soa_##name##_row_t row) { \
+        if (s->len < s->cap || kg_soa_##name##_reserve(s, kg_max(s->cap * 2, 8))) { \
+            isize i = s->len; \
+            FIELDS(KG_SOA_SET_) \
+            s->len++; \
+            return true; \
+        } \
+        return false; \
+    } \
+    kg_static kg_inline kg_soa_##name##_row_t kg_soa_##name##_get(const kg_soa_##name##_t* s, isize i) { \
+        kg_soa_##name##_row_t out; \
+        FIELDS(KG_SOA_GET_) \
+        return out; \
+    } \
+    kg_static kg_inline void kg_soa_##name##_set(kg_soa_##name##_t* s, isize i, kg_soa_##name##_row_t row) { \
+        FIELDS(KG_SOA_SET_) \
+    } \
+    kg_static kg_inline b32 kg_soa_##name##_pop(kg_soa_##name##_t* s) { \
+        if (s->len > 0) { \
+            s->len--; \
+            return true; \
+        } \
+        return false; \
+    } \
+    kg_static kg_inline b32 kg_soa_##name##_swap_remove(kg_soa_##name##_t* s, isize i) { \
+        if (kg_is_within(i, 0, s->len - 1)) { \
+            FIELDS(KG_SOA_MOVE_) \
+            s->len--; \
+            return true; \
+        } \
+        return false; \
+    } \
+    kg_static kg_inline isize kg_soa_##name##_len(const kg_soa_##name##_t* s) { \
+        return s ? s->len : 0; \
+    } \
+    kg_static kg_inline isize kg_soa_##name##_cap(const kg_soa_##name##_t* s) { \
+        return s ? s->cap : 0; \
+    } \
+    kg_static kg_inline isize kg_soa_##name##_mem_size(const kg_soa_##name##_t* s) { \
+        return s && s->mem ? kg_soa_##name##_mem_size_for(s->cap) : 0; \
+    } \
+    kg_static kg_inline void kg_soa_##name##_clear(kg_soa_##name##_t* s) { \
+        s->len = 0; \
+    } \
+    kg_static kg_inline void kg_soa_##name##_destroy(kg_soa_##name##_t* s) { \
+        if (s) { \
+            if (s->mem) { \
+                kg_allocator_free(s->allocator, s->mem, kg_soa_##name##_mem_size(s)); \
+            } \
+            kg_mem_zero(s, kg_sizeof(kg_soa_##name##_t)); \
+        } \
+    }
+
+#define KG_CHUNK_BUILDER_DEFAULT_CHUNK_SIZE kg_kibibytes(64)
+#define KG_CHUNK_BUILDER_IOV_LEN            64
+
+// Segmented builder, text goes into a list of kg_string_t chunks that never move once written.
+// Output is either streamed to a file descriptor with writev or detached as a kg_string_t,
+// the detach is zero copy while everything fits in one chunk.
+typedef struct kg_chunk_builder_t {
+    kg_allocator_t*    allocator;
+    kg_darray_string_t chunks;
+    isize              chunk_size;
+    isize              len;
+} kg_chunk_builder_t;
+
+b32         kg_chunk_builder_create     (kg_chunk_builder_t* b, kg_allocator_t* a, isize chunk_size);
+b32         kg_chunk_builder_write      (kg_chunk_builder_t* b, const void* v, isize n);
+b32         kg_chunk_builder_write_cstr (kg_chunk_builder_t* b, const char* c);
+b32         kg_chunk_builder_write_str  (kg_chunk_builder_t* b, const kg_str_t s);
+b32         kg_chunk_builder_write_fmt  (kg_chunk_builder_t* b, const char* fmt, ...);
+b32         kg_chunk_builder_write_fmt_v(kg_chunk_builder_t* b, const char* fmt, va_list args);
+isize       kg_chunk_builder_write_fd   (kg_chunk_builder_t* b, i32 fd);
+kg_string_t kg_chunk_builder_to_string  (const kg_chunk_builder_t* b, kg_allocator_t* a);
+kg_string_t kg_chunk_builder_detach     (kg_chunk_builder_t* b);
+isize       kg_chunk_builder_len        (const kg_chunk_builder_t* b);
+isize       kg_chunk_builder_chunks_len (const kg_chunk_builder_t* b);
+isize       kg_chunk_builder_mem_size   (const kg_chunk_builder_t* b);
+void        kg_chunk_builder_reset      (kg_chunk_builder_t* b);
+void        kg_chunk_builder_destroy    (kg_chunk_builder_t* b);
+
+void* kg_small_darray_grow2_            (kg_darray_base_t* b, isize n, const void* small, void** out_ptr);
+void* kg_small_darray_ensure_available2_(kg_darray_base_t* b, isize n, const void* small, void** out_ptr);
+
+// Keeps up to N elements inside the struct, ptr stays null until the array spills to the
+// allocator. Index through kg_small_darray_##name##_data, it is valid after the struct moves.
+// create returns false when cap > N and the spill fails, d is still a usable inline array then.
+#define KG_SMALL_DARRAY_TYPEDEF(T, name, N) \
+    typedef struct kg_small_darray_##name##_t { \
+        kg_darray_base_t base; \
+        T*               ptr; \
+        T                small[N]; \
+    } kg_small_darray_##name##_t; \
+    kg_static kg_inline b32 kg_small_darray_##name##_create(kg_small_darray_##name##_t* d, kg_allocator_t* a, isize cap) { \
+        *d = (kg_small_darray_##name##_t){0}; \
+        d->base = (kg_darray_base_t){.cap = N, .stride = kg_sizeof(T), .allocator = a}; \
+        return cap <= N || null != kg_small_darray_grow2_(&d->base, cap - N, d->small, kg_cast(void**)&d->ptr); \
+    } \
+    kg_static kg_inline T* kg_small_darray_##name##_data(kg_small_darray_##name##_t* d) { \
+        return d->ptr ? d->ptr : d->small; \
+    } \
+    kg_static kg_inline b32 kg_small_darray_##name##_is_inline(const kg_small_darray_##name##_t* d) { \
+        return d->ptr == null; \
+    } \
+    kg_static kg_inline b32 kg_small_darray_##name##_append(kg_small_darray_##name##_t* d, T v) { \
+        if (d->base.len < d->base.cap || kg_small_darray_ensure_available2_(&d->base, 1, d->small, kg_cast(void**)&d->ptr)) { \
+            kg_small_darray_##name##_data(d)[d->base.len] = v; \
+            d->base.len++; \
+            return true; \
+        } \
+        return false; \
+    } \
+    kg_static kg_inline isize kg_small_darray_##name##_len(const kg_small_darray_##name##_t* d) { \
+        return d ? d->base.len : 0; \
+    } \
+    kg_static kg_inline isize kg_small_darray_##name##_cap(const kg_small_darray_##name##_t* d) { \
+        return d ? d->base.cap : 0; \
+    } \
+    kg_static kg_inline isize kg_small_darray_##name##_stride(const kg_small_darray_##name##_t* d) { \
+        return d ? d->base.stride : 0; \
+    } \
+    kg_static kg_inline isize kg_small_darray_##name##_available(const kg_small_darray_##name##_t* d) { \
+        return d ? d->base.cap - d->base.len : 0; \
+    } \
+    kg_static kg_inline b32 kg_small_darray_##name##_grow(kg_small_darray_##name##_t* d, isize n) { \
+        return null != kg_small_darray_grow2_(&d->base, n, d->small, kg_cast(void**)&d->ptr); \
+    } \
+    kg_static kg_inline b32 kg_small_darray_##name##_pop(kg_small_darray_##name##_t* d) { \
+        if (d->base.len > 0) { \
+            d->base.len--; \
+            return true; \
+        } \
+        return false; \
+    } \
+    kg_static kg_inline b32 kg_small_darray_##name##_swap_remove(kg_small_darray_##name##_t* d, isize i) { \
+        if (kg_is_within(i, 0, d->base.len - 1)) { \
+            T* data = kg_small_darray_##name##_data(d); \
+            data[i] = data[d->base.len - 1]; \
+            d->base.len--; \
+            return true; \
+        } \
+        return false; \
+    } \
+    kg_static kg_inline isize kg_small_darray_##name##_mem_size(const kg_small_darray_##name##_t* d) { \
+        return d && d->ptr ? d->base.cap * d->base.stride : 0; \
+    } \
+    kg_static kg_inline void kg_small_darray_##name##_destroy(kg_small_darray_##name##_t* d) { \
+        if (d) { \
+            if (d->ptr) { \
+                kg_allocator_free(d->base.allocator, d->ptr, kg_small_darray_##name##_mem_size(d)); \
+            } \
+            kg_mem_zero(d, kg_sizeof(kg_small_darray_##name##_t)); \
+        } \
+    }
+
 typedef struct kg_darray_header_t {
     isize           len;
     isize           cap;
@@ -430,6 +1281,10 @@ typedef struct kg_darray_header_t {
 
 void*   kg_darray_create_                (kg_allocator_t* a, isize stride, isize cap);
 void*   kg_darray_grow_                  (void* d, isize n);
+#ifdef KG_ALLOCATOR_PROFILE
+#define kg_darray_create_(a, stride, cap)        kg_allocator_profile_scope_(kg_darray_create_(a, stride, cap))
+#define kg_darray_grow_(d, n)                    kg_allocator_profile_scope_(kg_darray_grow_(d, n))
+#endif
 #define kg_darray_header(d)              (kg_cast(kg_darray_header_t*)d - 1)
 #define kg_darray_create(a, T, cap)      kg_cast(T*)kg_darray_create_(a, kg_sizeof(T), cap)
 #define kg_darray_pop(d)                 do { kg_darray_header_t* h = kg_darray_header(d); if (h->len > 0) { h->len--; } } while(0)
@@ -462,34 +1317,270 @@ void*   kg_darray_grow_                  (void* d, isize n);
     kg_allocator_free(h->allocator, h, kg_darray_mem_size(d)); \
 } while(0)
 
-/*typedef struct kg_map_kv_t kg_map_kv_t;*/
-/**/
-/*typedef struct kg_map_base_t {*/
-/*    kg_allocator_t* allocator;*/
-/*    kg_map_kv_t*    buckets;*/
-/*    isize           kv_count;*/
-/*    isize           key_size;*/
-/*    isize           value_size;*/
-/*} kg_map_base_t;*/
-/**/
-/*#define KG_MAP_TYPEDEF(K, T, name) \*/
-/*    typedef struct kg_map_##name##_t { \*/
-/*    } kg_map_##name##_t; \*/
-/*    b32 kg_map_##name##_create(kg_map_##name##_t* m, kg_allocator_t* a, isize buckets_len) { \*/
-/*        b32 ok; \*/
-/*        if (m && a && buckets > 0) { \*/
-/*            m->kv_count = 0; \*/
-/*            m->allocator = a; \*/
-/*            m->buckets = kg_allocator_alloc(a, kg_sizeof(kg_map_kv_t) * buckets); \*/
-/*            if (m->buckets) { \*/
-/*                ok = true; \*/
-/*            } \*/
-/*        } \*/
-/*        return ok; \*/
-/*    }*/
+u64 kg_hash_bytes(const void* ptr, isize size);
+u64 kg_hash_u64  (u64 u);
+
+// Swiss table: one control byte per slot holds EMPTY, DELETED or the low 7 bits
+// of the hash, groups of 16 control bytes are matched at once. The first group is
+// mirrored past the end so a group can start at any slot.
+#define KG_MAP_GROUP_LEN    16
+#define KG_MAP_MIN_CAP      16
+#define KG_MAP_CTRL_EMPTY   kg_cast(i8)(-128)
+#define KG_MAP_CTRL_DELETED kg_cast(i8)(-2)
+
+typedef struct kg_map_base_t {
+    kg_allocator_t* allocator;
+    i8*             ctrl;
+    isize           cap;
+    isize           len;
+    isize           growth_left;
+    isize           stride;
+} kg_map_base_t;
+
+void* kg_map_table_create_  (kg_map_base_t* b, kg_allocator_t* a, isize stride, isize cap);
+void  kg_map_table_destroy_ (kg_map_base_t* b, void* entries);
+void  kg_map_table_clear_   (kg_map_base_t* b);
+isize kg_map_table_mem_size_(isize stride, isize cap);
+isize kg_map_cap_for_       (isize len);
+
+kg_static kg_inline u32 kg_map_group_match_(const i8* ctrl, i8 h2) {
+#if defined(__SSE2__)
+    __m128i group = _mm_loadu_si128(kg_cast(const __m128i*)ctrl);
+    return kg_cast(u32)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(h2)));
+#else
+    u32 out = 0;
+    for (isize i = 0; i < KG_MAP_GROUP_LEN; i++) {
+        out |= kg_cast(u32)(ctrl[i] == h2) << i;
+    }
+    return out;
+#endif
+}
+kg_static kg_inline u32 kg_map_group_match_empty_(const i8* ctrl) {
+    return kg_map_group_match_(ctrl, KG_MAP_CTRL_EMPTY);
+}
+kg_static kg_inline u32 kg_map_group_match_free_(const i8* ctrl) {
+#if defined(__SSE2__)
+    return kg_cast(u32)_mm_movemask_epi8(_mm_loadu_si128(kg_cast(const __m128i*)ctrl));
+#else
+    u32 out = 0;
+    for (isize i = 0; i < KG_MAP_GROUP_LEN; i++) {
+        out |= kg_cast(u32)(ctrl[i] < 0) << i;
+    }
+    return out;
+#endif
+}
+kg_static kg_inline void kg_map_set_ctrl_(kg_map_base_t* b, isize i, i8 c) {
+    b->ctrl[i] = c;
+    if (i < KG_MAP_GROUP_LEN) {
+        b->ctrl[b->cap + i] = c;
+    }
+}
+kg_static kg_inline isize kg_map_find_free_(const kg_map_base_t* b, u64 hash) {
+    isize mask = b->cap - 1;
+    isize pos = kg_cast(isize)(hash >> 7) & mask;
+    for (isize step = KG_MAP_GROUP_LEN;; step += KG_MAP_GROUP_LEN) {
+        u32 match = kg_map_group_match_free_(b->ctrl + pos);
+        if (match) {
+            return (pos + __builtin_ctz(match)) & mask;
+        }
+        pos = (pos + step) & mask;
+    }
+}
+// A slot goes back to EMPTY when the run of full slots around it is shorter than
+// a group, no probe could have passed over it then. Otherwise it becomes DELETED.
+kg_static kg_inline void kg_map_erase_at_(kg_map_base_t* b, isize i) {
+    u32 empty_before = kg_map_group_match_empty_(b->ctrl + ((i - KG_MAP_GROUP_LEN) & (b->cap - 1)));
+    u32 empty_after = kg_map_group_match_empty_(b->ctrl + i);
+    b32 was_never_full = empty_before && empty_after && __builtin_ctz(empty_after) + __builtin_clz(empty_before) - 16 < KG_MAP_GROUP_LEN;
+    kg_map_set_ctrl_(b, i, was_never_full ? KG_MAP_CTRL_EMPTY : KG_MAP_CTRL_DELETED);
+    b->len--;
+    if (was_never_full) {
+        b->growth_left++;
+    }
+}
+
+#define KG_MAP_TYPEDEF_FN(K, V, name, hash_fn, is_equal_fn) \
+    typedef struct kg_map_##name##_entry_t { \
+        K key; \
+        V value; \
+    } kg_map_##name##_entry_t; \
+    typedef struct kg_map_##name##_t { \
+        kg_map_base_t            base; \
+        kg_map_##name##_entry_t* entries; \
+    } kg_map_##name##_t; \
+    kg_static kg_inline b32 kg_map_##name##_create(kg_map_##name##_t* m, kg_allocator_t* a, isize cap) { \
+        *m = (kg_map_##name##_t){0}; \
+        m->entries = kg_cast(kg_map_##name##_entry_t*)kg_map_table_create_(&m->base, a, kg_sizeof(kg_map_##name##_entry_t), kg_map_cap_for_(cap)); \
+        return m->entries != null; \
+    } \
+    kg_static kg_inline isize kg_map_##name##_find_(const kg_map_##name##_t* m, const K key, u64 hash) { \
+        isize mask = m->base.cap - 1; \
+        isize pos = kg_cast(isize)(hash >> 7) & mask; \
+        i8 h2 = kg_cast(i8)(hash & 0x7f); \
+        for (isize step = KG_MAP_GROUP_LEN;; step += KG_MAP_GROUP_LEN) { \
+            const i8* group = m->base.ctrl + pos; \
+            for (u32 match = kg_map_group_match_(group, h2); match; match &= match - 1) { \
+                isize i = (pos + __builtin_ctz(match)) & mask; \
+                if (is_equal_fn(m->entries[i].key, key)) { \
+                    return i; \
+                } \
+            } \
+            if (kg_map_group_match_empty_(group)) { \
+                return -1; \
+            } \
+            pos = (pos + step) & mask; \
+        } \
+    } \
+    kg_static kg_inline b32 kg_map_##name##_rehash_(kg_map_##name##_t* m, isize cap) { \
+        kg_map_base_t base; \
+        kg_map_##name##_entry_t* entries = kg_cast(kg_map_##name##_entry_t*)kg_map_table_create_(&base, m->base.allocator, m->base.stride, cap); \
+        if (!entries) { \
+            return false; \
+        } \
+        for (isize i = 0; i < m->base.cap; i++) { \
+            if (m->base.ctrl[i] >= 0) { \
+                u64 hash = hash_fn(m->entries[i].key); \
+                isize j = kg_map_find_free_(&base, hash); \
+                kg_map_set_ctrl_(&base, j, kg_cast(i8)(hash & 0x7f)); \
+                entries[j] = m->entries[i]; \
+            } \
+        } \
+        base.len = m->base.len; \
+        base.growth_left -= m->base.len; \
+        kg_map_table_destroy_(&m->base, m->entries); \
+        m->base = base; \
+        m->entries = entries; \
+        return true; \
+    } \
+    kg_static kg_inline b32 kg_map_##name##_reserve(kg_map_##name##_t* m, isize len) { \
+        return len <= m->base.len + m->base.growth_left || kg_map_##name##_rehash_(m, kg_map_cap_for_(len)); \
+    } \
+    kg_static kg_inline isize kg_map_##name##_prepare_insert_(kg_map_##name##_t* m, u64 hash) { \
+        isize i = kg_map_find_free_(&m->base, hash); \
+        if (m->base.growth_left == 0 && m->base.ctrl[i] == KG_MAP_CTRL_EMPTY) { \
+            /* up to 25/32 live slots the tombstones are dropped at the same capacity */ \
+            isize cap = m->base.len * 32 <= m->base.cap * 25 ? m->base.cap : m->base.cap * 2; \
+            if (!kg_map_##name##_rehash_(m, cap)) { \
+                return -1; \
+            } \
+            i = kg_map_find_free_(&m->base, hash); \
+        } \
+        if (m->base.ctrl[i] == KG_MAP_CTRL_EMPTY) { \
+            m->base.growth_left--; \
+        } \
+        kg_map_set_ctrl_(&m->base, i, kg_cast(i8)(hash & 0x7f)); \
+        m->base.len++; \
+        return i; \
+    } \
+    kg_static kg_inline kg_map_##name##_entry_t* kg_map_##name##_get_or_insert_entry(kg_map_##name##_t* m, const K key, b32* out_inserted) { \
+        u64 hash = hash_fn(key); \
+        isize i = kg_map_##name##_find_(m, key, hash); \
+        b32 inserted = false; \
+        if (i < 0) { \
+            i = kg_map_##name##_prepare_insert_(m, hash); \
+            if (i >= 0) { \
+                m->entries[i].key = key; \
+                kg_mem_zero(&m->entries[i].value, kg_sizeof(V)); \
+                inserted = true; \
+            } \
+        } \
+        if (out_inserted) { \
+            *out_inserted = inserted; \
+        } \
+        return i >= 0 ? &m->entries[i] : null; \
+    } \
+    kg_static kg_inline V* kg_map_##name##_get_or_insert(kg_map_##name##_t* m, const K key, b32* out_inserted) { \
+        kg_map_##name##_entry_t* entry = kg_map_##name##_get_or_insert_entry(m, key, out_inserted); \
+        return entry ? &entry->value : null; \
+    } \
+    kg_static kg_inline b32 kg_map_##name##_set(kg_map_##name##_t* m, const K key, V value) { \
+        V* v = kg_map_##name##_get_or_insert(m, key, null); \
+        if (v) { \
+            *v = value; \
+        } \
+        return v != null; \
+    } \
+    kg_static kg_inline V* kg_map_##name##_get(const kg_map_##name##_t* m, const K key) { \
+        isize i = kg_map_##name##_find_(m, key, hash_fn(key)); \
+        return i >= 0 ? &m->entries[i].value : null; \
+    } \
+    kg_static kg_inline b32 kg_map_##name##_has(const kg_map_##name##_t* m, const K key) { \
+        return kg_map_##name##_find_(m, key, hash_fn(key)) >= 0; \
+    } \
+    kg_static kg_inline b32 kg_map_##name##_remove(kg_map_##name##_t* m, const K key) { \
+        isize i = kg_map_##name##_find_(m, key, hash_fn(key)); \
+        if (i >= 0) { \
+            kg_map_erase_at_(&m->base, i); \
+        } \
+        return i >= 0; \
+    } \
+    kg_static kg_inline kg_map_##name##_entry_t* kg_map_##name##_next(const kg_map_##name##_t* m, isize* it) { \
+        for (; *it < m->base.cap; (*it)++) { \
+            if (m->base.ctrl[*it] >= 0) { \
+                return &m->entries[(*it)++]; \
+            } \
+        } \
+        return null; \
+    } \
+    kg_static kg_inline isize kg_map_##name##_len(const kg_map_##name##_t* m) { \
+        return m ? m->base.len : 0; \
+    } \
+    kg_static kg_inline isize kg_map_##name##_cap(const kg_map_##name##_t* m) { \
+        return m ? m->base.cap : 0; \
+    } \
+    kg_static kg_inline isize kg_map_##name##_mem_size(const kg_map_##name##_t* m) { \
+        return m && m->entries ? kg_map_table_mem_size_(m->base.stride, m->base.cap) : 0; \
+    } \
+    kg_static kg_inline void kg_map_##name##_clear(kg_map_##name##_t* m) { \
+        kg_map_table_clear_(&m->base); \
+    } \
+    kg_static kg_inline void kg_map_##name##_destroy(kg_map_##name##_t* m) { \
+        if (m) { \
+            kg_map_table_destroy_(&m->base, m->entries); \
+            kg_mem_zero(m, kg_sizeof(kg_map_##name##_t)); \
+        } \
+    }
+
+// Keys are hashed and compared bytewise, keys with padding or pointers to the
+// actual key data need KG_MAP_TYPEDEF_FN.
+#define KG_MAP_TYPEDEF(K, V, name) \
+    kg_static kg_inline u64 kg_map_##name##_hash_bytes_(const K key) { \
+        return kg_hash_bytes(&key, kg_sizeof(K)); \
+    } \
+    kg_static kg_inline b32 kg_map_##name##_is_equal_bytes_(const K key, const K other) { \
+        return kg_mem_compare(&key, &other, kg_sizeof(K)) == 0; \
+    } \
+    KG_MAP_TYPEDEF_FN(K, V, name, kg_map_##name##_hash_bytes_, kg_map_##name##_is_equal_bytes_)
+
+#define KG_INTERNER_ID_INVALID U32_MAX
+
+kg_static kg_inline b32 kg_interner_is_equal_(const kg_str_t s, const kg_str_t other) {
+    return s.len == other.len && kg_mem_compare(s.ptr, other.ptr, s.len) == 0;
+}
+
+KG_MAP_TYPEDEF_FN(kg_str_t, u32, interner, kg_str_hash, kg_interner_is_equal_)
+
+// Interned bytes live in a chained arena and never move, so the returned kg_str_t
+// handles stay valid until destroy and equal strings share one pointer.
+typedef struct kg_interner_t {
+    kg_arena_t        arena;
+    kg_map_interner_t ids;
+    kg_darray_str_t   strs;
+} kg_interner_t;
 
+b32      kg_interner_create    (kg_interner_t* i, kg_allocator_t* a, isize block_size);
+u32      kg_interner_intern    (kg_interner_t* i, const kg_str_t s);
+kg_str_t kg_interner_intern_str(kg_interner_t* i, const kg_str_t s);
+u32      kg_interner_find      (const kg_interner_t* i, const kg_str_t s);
+kg_str_t kg_interner_str       (const kg_interner_t* i, u32 id);
+isize    kg_interner_len       (const kg_interner_t* i);
+isize    kg_interner_mem_size  (const kg_interner_t* i);
+void     kg_interner_destroy   (kg_interner_t* i);
+
+// Circular buffer, the element i lives at (head + i) % cap.
 typedef struct kg_queue_t {
     kg_allocator_t* allocator;
+    isize           head;
     isize           len;
     isize           cap;
     isize           stride;
@@ -509,6 +1600,107 @@ isize  kg_queue_cap             (const kg_queue_t* q);
 isize  kg_queue_mem_size        (const kg_queue_t* q);
 void   kg_queue_destroy         (kg_queue_t* q);
 
+typedef struct kg_queue_base_t {
+    kg_allocator_t* allocator;
+    isize           head;
+    isize           len;
+    isize           cap;
+    isize           stride;
+} kg_queue_base_t;
+
+void* kg_queue_create2_          (kg_allocator_t* a, isize stride, isize cap, kg_queue_base_t* out_b);
+void* kg_queue_grow2_            (kg_queue_base_t* b, isize n, void** out_ptr);
+void* kg_queue_ensure_available2_(kg_queue_base_t* b, isize n, void** out_ptr);
+
+#define KG_CACHE_LINE_SIZE 64
+
+// Wait free ring for one producer and one consumer thread. Each side keeps a cached copy
+// of the opposite index on its own cache line and reloads it only when the cache says the
+// ring is full or empty. The acquire calls hand out a contiguous span inside the ring,
+// the commit calls publish it.
+typedef struct kg_spsc_ring_t {
+    kg_allocator_t* allocator;
+    u8*             ptr;
+    isize           mask;
+    isize           stride;
+    u8              pad0_[KG_CACHE_LINE_SIZE];
+    isize           write_pos;
+    isize           read_pos_cached;
+    u8              pad1_[KG_CACHE_LINE_SIZE - 2 * kg_sizeof(isize)];
+    isize           read_pos;
+    isize           write_pos_cached;
+    u8              pad2_[KG_CACHE_LINE_SIZE - 2 * kg_sizeof(isize)];
+} kg_spsc_ring_t;
+
+b32   kg_spsc_ring_create       (kg_spsc_ring_t* r, kg_allocator_t* a, isize stride, isize cap);
+isize kg_spsc_ring_push         (kg_spsc_ring_t* r, const void* src, isize n);
+isize kg_spsc_ring_pop          (kg_spsc_ring_t* r, void* dst, isize n);
+void* kg_spsc_ring_write_acquire(kg_spsc_ring_t* r, isize* n);
+void  kg_spsc_ring_write_commit (kg_spsc_ring_t* r, isize n);
+void* kg_spsc_ring_read_acquire (kg_spsc_ring_t* r, isize* n);
+void  kg_spsc_ring_read_commit  (kg_spsc_ring_t* r, isize n);
+isize kg_spsc_ring_len          (kg_spsc_ring_t* r);
+isize kg_spsc_ring_cap          (const kg_spsc_ring_t* r);
+isize kg_spsc_ring_mem_size     (const kg_spsc_ring_t* r);
+void  kg_spsc_ring_destroy      (kg_spsc_ring_t* r);
+
+#define KG_QUEUE_TYPEDEF(T, name) \
+    typedef struct kg_queue_##name##_t { \
+        kg_queue_base_t base; \
+        T*              ptr; \
+    } kg_queue_##name##_t; \
+    kg_static kg_inline kg_queue_##name##_t kg_queue_##name##_create(kg_allocator_t* a, isize cap) { \
+        kg_queue_##name##_t out = {0}; \
+        out.ptr = kg_cast(T*)kg_queue_create2_(a, kg_sizeof(T), cap, &out.base); \
+        return out; \
+    } \
+    kg_static kg_inline b32 kg_queue_##name##_enqueue(kg_queue_##name##_t* q, T v) { \
+        if (kg_queue_ensure_available2_(&q->base, 1, kg_cast(void**)&q->ptr)) { \
+            isize i = q->base.head + q->base.len; \
+            q->ptr[i < q->base.cap ? i : i - q->base.cap] = v; \
+            q->base.len++; \
+            return true; \
+        } \
+        return false; \
+    } \
+    kg_static kg_inline b32 kg_queue_##name##_deque(kg_queue_##name##_t* q, T* o) { \
+        if (q->base.len > 0) { \
+            *o = q->ptr[q->base.head]; \
+            q->base.head = q->base.head + 1 < q->base.cap ? q->base.head + 1 : 0; \
+            q->base.len--; \
+            return true; \
+        } \
+        return false; \
+    } \
+    kg_static kg_inline b32 kg_queue_##name##_peek(const kg_queue_##name##_t* q, T* o) { \
+        if (q->base.len > 0) { \
+            *o = q->ptr[q->base.head]; \
+            return true; \
+        } \
+        return false; \
+    } \
+    kg_static kg_inline b32 kg_queue_##name##_grow(kg_queue_##name##_t* q, isize n) { \
+        return null != kg_queue_grow2_(&q->base, n, kg_cast(void**)&q->ptr); \
+    } \
+    kg_static kg_inline b32 kg_queue_##name##_is_empty(const kg_queue_##name##_t* q) { \
+        return q ? q->base.len <= 0 : true; \
+    } \
+    kg_static kg_inline isize kg_queue_##name##_len(const kg_queue_##name##_t* q) { \
+        return q ? q->base.len : 0; \
+    } \
+    kg_static kg_inline isize kg_queue_##name##_cap(const kg_queue_##name##_t* q) { \
+        return q ? q->base.cap : 0; \
+    } \
+    kg_static kg_inline isize kg_queue_##name##_mem_size(const kg_queue_##name##_t* q) { \
+        return q ? q->base.cap * q->base.stride : 0; \
+    } \
+    kg_static kg_inline void kg_queue_##name##_destroy(kg_queue_##name##_t* q) { \
+        if (q) { \
+            kg_allocator_free(q->base.allocator, q->ptr, kg_queue_##name##_mem_size(q)); \
+            kg_mem_zero(q, kg_sizeof(kg_queue_##name##_t)); \
+        } \
+    }
+
 typedef enum kg_file_mode_t {
     KG_FILE_MODE_READ  = 0x1,
     KG_FILE_MODE_WRITE = 0x2,
@@ -613,6 +1805,8 @@ i32 kg_i64_compare  (const void* a, const void* b);
 #include <unistd.h>
 #include <sys/time.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
 
 kg_inline void* kg_mem_alloc_zero(isize size) {
     return calloc(1, size);
@@ -648,76 +1842,302 @@ kg_inline void* kg_mem_move(void* dest, const void* src, isize size) {
     return memmove(dest, src, size);
 }
 
-kg_inline void* kg_allocator_alloc(kg_allocator_t* a, isize s) {
-    return a->proc.alloc(a, s);
+isize kg_vm_page_size(void) {
+    kg_static isize page_size = 0;
+    if (page_size == 0) {
+        page_size = kg_cast(isize)sysconf(_SC_PAGESIZE);
+    }
+    return page_size;
 }
-kg_inline void kg_allocator_free(kg_allocator_t* a, void* ptr, isize s) {
-    a->proc.free(a, ptr, s);
+void* kg_vm_alloc(isize size) {
+    void* out = mmap(null, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return out == MAP_FAILED ? null : out;
 }
-kg_inline void kg_allocator_free_all(kg_allocator_t* a, b32 clear) {
-    a->proc.free_all(a, clear);
+void* kg_vm_reserve(isize size) {
+    void* out = mmap(null, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return out == MAP_FAILED ? null : out;
 }
-kg_inline void* kg_allocator_resize(kg_allocator_t* a, void* ptr, isize old_size, isize new_size) {
-    return a->proc.resize(a, ptr, old_size, new_size);
+void* kg_vm_remap(void* ptr, isize old_size, isize new_size) {
+    void* out = mremap(ptr, old_size, new_size, MREMAP_MAYMOVE);
+    return out == MAP_FAILED ? null : out;
 }
-
-void* kg_allocator_default_alloc(kg_allocator_t* a, isize size) {
-    kg_cast(void)a;
-    return kg_mem_alloc_zero(size);
+b32 kg_vm_commit(void* ptr, isize size) {
+    return mprotect(ptr, size, PROT_READ | PROT_WRITE) == 0;
 }
-void kg_allocator_default_free(kg_allocator_t* a, void* ptr, isize size) {
-    kg_cast(void)a;
-    kg_cast(void)size;
-    kg_mem_free(ptr);
+b32 kg_vm_decommit(void* ptr, isize size) {
+    b32 out_ok = madvise(ptr, size, MADV_DONTNEED) == 0;
+    if (out_ok) {
+        out_ok = mprotect(ptr, size, PROT_NONE) == 0;
+    }
+    return out_ok;
 }
-void kg_allocator_default_free_all(kg_allocator_t* a, b32 clear) {
-    kg_cast(void)a;
-    kg_cast(void)clear;
+b32 kg_vm_huge_pages(void* ptr, isize size) {
+    return madvise(ptr, size, MADV_HUGEPAGE) == 0;
 }
-void* kg_allocator_default_resize(kg_allocator_t* a, void* ptr, isize old_size, isize new_size) {
-    kg_cast(void)a;
-    kg_cast(void)old_size;
+void kg_vm_release(void* ptr, isize size) {
+    if (ptr) {
+        munmap(ptr, size);
+    }
+}
+
+kg_inline void* (kg_allocator_alloc)(kg_allocator_t* a, isize s) {
+    return a->proc.alloc(a, s);
+}
+kg_inline void* (kg_allocator_alloc_uninit)(kg_allocator_t* a, isize s) {
+    return a->proc.alloc_uninit ? a->proc.alloc_uninit(a, s) : a->proc.alloc(a, s);
+}
+b32 (kg_allocator_alloc_batch)(kg_allocator_t* a, isize s, isize n, void** out_ptrs) {
+    b32 out_ok = true;
+    if (a->proc.alloc_batch) {
+        out_ok = a->proc.alloc_batch(a, s, n, out_ptrs);
+    } else {
+        for (isize i = 0; i < n; i++) {
+            out_ptrs[i] = a->proc.alloc(a, s);
+            if (!out_ptrs[i]) {
+                kg_allocator_free_batch(a, out_ptrs, i, s);
+                out_ok = false;
+                break;
+            }
+        }
+    }
+    return out_ok;
+}
+kg_inline void kg_allocator_free(kg_allocator_t* a, void* ptr, isize s) {
+    a->proc.free(a, ptr, s);
+}
+void kg_allocator_free_batch(kg_allocator_t* a, void** ptrs, isize n, isize s) {
+    if (a->proc.free_batch) {
+        a->proc.free_batch(a, ptrs, n, s);
+    } else {
+        for (isize i = 0; i < n; i++) {
+            a->proc.free(a, ptrs[i], s);
+        }
+    }
+}
+kg_inline void kg_allocator_free_all(kg_allocator_t* a, b32 clear) {
+    a->proc.free_all(a, clear);
+}
+kg_inline void* (kg_allocator_resize)(kg_allocator_t* a, void* ptr, isize old_size, isize new_size) {
+    return a->proc.resize(a, ptr, old_size, new_size);
+}
+
+void* kg_allocator_default_alloc(kg_allocator_t* a, isize size) {
+    kg_cast(void)a;
+    return kg_mem_alloc_zero(size);
+}
+void* kg_allocator_default_alloc_uninit(kg_allocator_t* a, isize size) {
+    kg_cast(void)a;
+    return kg_mem_alloc(size);
+}
+b32 kg_allocator_default_alloc_batch(kg_allocator_t* a, isize size, isize n, void** out_ptrs) {
+    kg_cast(void)a;
+    b32 out_ok = true;
+    for (isize i = 0; i < n; i++) {
+        out_ptrs[i] = kg_mem_alloc_zero(size);
+        if (!out_ptrs[i]) {
+            while (i > 0) {
+                kg_mem_free(out_ptrs[--i]);
+            }
+            out_ok = false;
+            break;
+        }
+    }
+    return out_ok;
+}
+void kg_allocator_default_free(kg_allocator_t* a, void* ptr, isize size) {
+    kg_cast(void)a;
+    kg_cast(void)size;
+    kg_mem_free(ptr);
+}
+void kg_allocator_default_free_batch(kg_allocator_t* a, void** ptrs, isize n, isize size) {
+    kg_cast(void)a;
+    kg_cast(void)size;
+    for (isize i = 0; i < n; i++) {
+        kg_mem_free(ptrs[i]);
+    }
+}
+void kg_allocator_default_free_all(kg_allocator_t* a, b32 clear) {
+    kg_cast(void)a;
+    kg_cast(void)clear;
+}
+void* kg_allocator_default_resize(kg_allocator_t* a, void* ptr, isize old_size, isize new_size) {
+    kg_cast(void)a;
+    kg_cast(void)old_size;
     return kg_mem_resize(ptr, new_size);
 }
 kg_inline kg_allocator_t kg_allocator_default(void) {
     return (kg_allocator_t){
         .proc = {
-            .alloc    = kg_allocator_default_alloc,
-            .free     = kg_allocator_default_free,
-            .free_all = kg_allocator_default_free_all,
-            .resize   = kg_allocator_default_resize,
+            .alloc        = kg_allocator_default_alloc,
+            .alloc_uninit = kg_allocator_default_alloc_uninit,
+            .alloc_batch  = kg_allocator_default_alloc_batch,
+            .free         = kg_allocator_default_free,
+            .free_batch   = kg_allocator_default_free_batch,
+            .free_all     = kg_allocator_default_free_all,
+            .resize       = kg_allocator_default_resize,
         },
         .context = null,
     };
 }
 
-void* kg_allocator_tracking_alloc(kg_allocator_t* a, isize size) {
+kg_static isize kg_allocator_mmap_size_(isize size) {
+    return kg_align_up(size, kg_vm_page_size());
+}
+kg_static void kg_allocator_mmap_advise_(kg_allocator_mmap_context_t* ctx, void* ptr, isize mem_size) {
+    if (ctx->huge_pages && mem_size >= KG_VM_HUGE_PAGE_SIZE) {
+        kg_vm_huge_pages(ptr, mem_size);
+    }
+}
+void* kg_allocator_mmap_alloc(kg_allocator_t* a, isize size) {
+    kg_allocator_mmap_context_t* ctx = kg_cast(kg_allocator_mmap_context_t*)a->context;
+    void* out_ptr = null;
+    if (size > 0) {
+        isize mem_size = kg_allocator_mmap_size_(size);
+        out_ptr = kg_vm_alloc(mem_size);
+        if (out_ptr) {
+            kg_allocator_mmap_advise_(ctx, out_ptr, mem_size);
+            kg_atomic_fetch_add(&ctx->mapped_size, mem_size);
+            kg_atomic_fetch_add(&ctx->map_count, 1);
+        }
+    }
+    return out_ptr;
+}
+void kg_allocator_mmap_free(kg_allocator_t* a, void* ptr, isize size) {
+    kg_allocator_mmap_context_t* ctx = kg_cast(kg_allocator_mmap_context_t*)a->context;
+    if (ptr) {
+        isize mem_size = kg_allocator_mmap_size_(size);
+        kg_vm_release(ptr, mem_size);
+        kg_atomic_fetch_sub(&ctx->mapped_size, mem_size);
+        kg_atomic_fetch_sub(&ctx->map_count, 1);
+    }
+}
+// Mappings are not tracked, every block has to be freed on its own.
+void kg_allocator_mmap_free_all(kg_allocator_t* a, b32 clear) {
+    kg_cast(void)a;
+    kg_cast(void)clear;
+}
+// Growth moves the page mappings instead of copying the bytes, new pages come zeroed.
+void* kg_allocator_mmap_resize(kg_allocator_t* a, void* ptr, isize old_size, isize new_size) {
+    kg_allocator_mmap_context_t* ctx = kg_cast(kg_allocator_mmap_context_t*)a->context;
+    void* out_ptr = null;
+    if (ptr == null) {
+        out_ptr = kg_allocator_mmap_alloc(a, new_size);
+    } else if (new_size > 0) {
+        isize old_mem_size = kg_allocator_mmap_size_(old_size);
+        isize new_mem_size = kg_allocator_mmap_size_(new_size);
+        if (old_mem_size == new_mem_size) {
+            out_ptr = ptr;
+        } else {
+            out_ptr = kg_vm_remap(ptr, old_mem_size, new_mem_size);
+            if (out_ptr) {
+                kg_allocator_mmap_advise_(ctx, out_ptr, new_mem_size);
+                kg_atomic_fetch_add(&ctx->mapped_size, new_mem_size - old_mem_size);
+                kg_atomic_fetch_add(&ctx->remap_count, 1);
+            }
+        }
+    }
+    return out_ptr;
+}
+// Every block is its own mapping with no shared bookkeeping to amortize, so alloc_batch
+// and free_batch are left to the per-block fallback on purpose.
+kg_inline kg_allocator_t kg_allocator_mmap(kg_allocator_mmap_context_t* ctx) {
+    kg_assert(ctx);
+    return (kg_allocator_t){
+        .proc = {
+            .alloc        = kg_allocator_mmap_alloc,
+            .alloc_uninit = kg_allocator_mmap_alloc,
+            .alloc_batch  = null,
+            .free         = kg_allocator_mmap_free,
+            .free_batch   = null,
+            .free_all     = kg_allocator_mmap_free_all,
+            .resize       = kg_allocator_mmap_resize,
+        },
+        .context = ctx,
+    };
+}
+
+kg_inline isize kg_allocator_tracking_histogram_index(isize size) {
+    isize out = 0;
+    if (size > 16) {
+        out = kg_min(64 - __builtin_clzll(kg_cast(u64)(size - 1)) - 4, KG_ALLOCATOR_TRACKING_HISTOGRAM_LEN - 1);
+    }
+    return out;
+}
+kg_static void kg_allocator_tracking_add_current_(kg_allocator_tracking_context_t* ctx, isize delta) {
+    isize current = kg_atomic_fetch_add(&ctx->current_allocated, delta) + delta;
+    isize peak = kg_atomic_load(&ctx->peak_allocated);
+    while (current > peak && !kg_atomic_cas(&ctx->peak_allocated, &peak, current)) {}
+}
+kg_static void* kg_allocator_tracking_alloc_(kg_allocator_t* a, isize size, b32 zero) {
     kg_allocator_tracking_context_t* ctx = kg_cast(kg_allocator_tracking_context_t*)a->context;
-    void* out_ptr = kg_allocator_alloc(ctx->parent_allocator, size);
+    void* out_ptr = zero ? kg_allocator_alloc(ctx->parent_allocator, size) : kg_allocator_alloc_uninit(ctx->parent_allocator, size);
     if (out_ptr) {
-        ctx->total_allocated += size;
-        ctx->alloc_count++;
-        ctx->current_allocated = ctx->total_allocated - ctx->total_freed;
-        kg_printf("[allocator](%s) alloc %lliB at %p\n", ctx->name, size, out_ptr);
+        kg_atomic_fetch_add(&ctx->total_allocated, size);
+        kg_atomic_fetch_add(&ctx->alloc_count, 1);
+        kg_atomic_fetch_add(&ctx->size_histogram[kg_allocator_tracking_histogram_index(size)], 1);
+        kg_allocator_tracking_add_current_(ctx, size);
+        if (!ctx->quiet) {
+            kg_printf("[allocator](%s) alloc %lliB at %p\n", ctx->name, size, out_ptr);
+        }
     }
     return out_ptr;
 }
+void* kg_allocator_tracking_alloc(kg_allocator_t* a, isize size) {
+    return kg_allocator_tracking_alloc_(a, size, true);
+}
+void* kg_allocator_tracking_alloc_uninit(kg_allocator_t* a, isize size) {
+    return kg_allocator_tracking_alloc_(a, size, false);
+}
+b32 kg_allocator_tracking_alloc_batch(kg_allocator_t* a, isize size, isize n, void** out_ptrs) {
+    kg_allocator_tracking_context_t* ctx = kg_cast(kg_allocator_tracking_context_t*)a->context;
+    b32 out_ok = kg_allocator_alloc_batch(ctx->parent_allocator, size, n, out_ptrs);
+    if (out_ok) {
+        kg_atomic_fetch_add(&ctx->total_allocated, size * n);
+        kg_atomic_fetch_add(&ctx->alloc_count, n);
+        kg_atomic_fetch_add(&ctx->size_histogram[kg_allocator_tracking_histogram_index(size)], n);
+        kg_allocator_tracking_add_current_(ctx, size * n);
+        if (!ctx->quiet) {
+            kg_printf("[allocator](%s) alloc batch %lli x %lliB\n", ctx->name, n, size);
+        }
+    }
+    return out_ok;
+}
 void kg_allocator_tracking_free(kg_allocator_t* a, void* ptr, isize size) {
     kg_allocator_tracking_context_t* ctx = kg_cast(kg_allocator_tracking_context_t*)a->context;
     if (ptr) {
-        ctx->total_freed += size;
-        ctx->current_allocated = ctx->total_allocated - ctx->total_freed;
-        ctx->free_count++;
+        kg_atomic_fetch_add(&ctx->total_freed, size);
+        kg_atomic_fetch_add(&ctx->free_count, 1);
+        kg_allocator_tracking_add_current_(ctx, -size);
         kg_allocator_free(ctx->parent_allocator, ptr, size);
-        kg_printf("[allocator](%s) free %lliB at %p\n", ctx->name, size, ptr);
+        if (!ctx->quiet) {
+            kg_printf("[allocator](%s) free %lliB at %p\n", ctx->name, size, ptr);
+        }
+    }
+}
+void kg_allocator_tracking_free_batch(kg_allocator_t* a, void** ptrs, isize n, isize size) {
+    kg_allocator_tracking_context_t* ctx = kg_cast(kg_allocator_tracking_context_t*)a->context;
+    isize freed_n = 0;
+    for (isize i = 0; i < n; i++) {
+        freed_n += ptrs[i] != null;
+    }
+    if (freed_n > 0) {
+        kg_atomic_fetch_add(&ctx->total_freed, size * freed_n);
+        kg_atomic_fetch_add(&ctx->free_count, freed_n);
+        kg_allocator_tracking_add_current_(ctx, -size * freed_n);
+        kg_allocator_free_batch(ctx->parent_allocator, ptrs, n, size);
+        if (!ctx->quiet) {
+            kg_printf("[allocator](%s) free batch %lli x %lliB\n", ctx->name, freed_n, size);
+        }
     }
 }
 void kg_allocator_tracking_free_all(kg_allocator_t* a, b32 clear) {
     kg_allocator_tracking_context_t* ctx = kg_cast(kg_allocator_tracking_context_t*)a->context;
-    ctx->total_freed = ctx->total_allocated;
-    ctx->current_allocated = 0;
+    kg_atomic_store(&ctx->total_freed, kg_atomic_load(&ctx->total_allocated));
+    kg_atomic_store(&ctx->current_allocated, 0);
     kg_allocator_free_all(ctx->parent_allocator, clear);
-    kg_printf("[allocator](%s) Free all (clear=%s)\n", ctx->name, clear ? "true" : "false");
+    if (!ctx->quiet) {
+        kg_printf("[allocator](%s) Free all (clear=%s)\n", ctx->name, clear ? "true" : "false");
+    }
 }
 void* kg_allocator_tracking_resize(kg_allocator_t* a, void* ptr, isize old_size, isize new_size) {
     kg_allocator_tracking_context_t* ctx = kg_cast(kg_allocator_tracking_context_t*)a->context;
@@ -725,25 +2145,45 @@ void* kg_allocator_tracking_resize(kg_allocator_t* a, void* ptr, isize old_size,
     if (ptr) {
         out_ptr = kg_allocator_resize(ctx->parent_allocator, ptr, old_size, new_size);
         if (out_ptr) {
-            ctx->resize_count++;
-            ctx->total_allocated += new_size;
-            ctx->total_freed += old_size;
-            ctx->current_allocated = ctx->total_allocated - ctx->total_freed;
-            kg_printf("[allocator](%s) resize from %lliB to %lliB, ptr %p -> %p\n", ctx->name, old_size, new_size, ptr, out_ptr);
+            kg_atomic_fetch_add(&ctx->resize_count, 1);
+            kg_atomic_fetch_add(&ctx->total_allocated, new_size);
+            kg_atomic_fetch_add(&ctx->total_freed, old_size);
+            kg_atomic_fetch_add(&ctx->size_histogram[kg_allocator_tracking_histogram_index(new_size)], 1);
+            kg_allocator_tracking_add_current_(ctx, new_size - old_size);
+            if (!ctx->quiet) {
+                kg_printf("[allocator](%s) resize from %lliB to %lliB, ptr %p -> %p\n", ctx->name, old_size, new_size, ptr, out_ptr);
+            }
         }
     }
     return out_ptr;
 }
+kg_allocator_tracking_snapshot_t kg_allocator_tracking_snapshot(const kg_allocator_tracking_context_t* ctx) {
+    kg_allocator_tracking_snapshot_t out = {
+        .total_allocated   = kg_atomic_load(&ctx->total_allocated),
+        .total_freed       = kg_atomic_load(&ctx->total_freed),
+        .current_allocated = kg_atomic_load(&ctx->current_allocated),
+        .peak_allocated    = kg_atomic_load(&ctx->peak_allocated),
+        .alloc_count       = kg_atomic_load(&ctx->alloc_count),
+        .free_count        = kg_atomic_load(&ctx->free_count),
+        .resize_count      = kg_atomic_load(&ctx->resize_count),
+    };
+    for (isize i = 0; i < KG_ALLOCATOR_TRACKING_HISTOGRAM_LEN; i++) {
+        out.size_histogram[i] = kg_atomic_load(&ctx->size_histogram[i]);
+    }
+    return out;
+}
 void kg_allocator_tracking_context_print(const kg_allocator_tracking_context_t ctx) {
-    kg_printf("[allocator](%s)\n\tparent_allocator:  %p\n\talloc_count:       %lli\n\tfree_count:        %lli\n\tresize_count:      %lli\n\ttotal_allocated:   %lliB\n\ttotal_freed:       %lliB\n\tcurrent_allocated: %lliB\n", 
+    kg_allocator_tracking_snapshot_t snapshot = kg_allocator_tracking_snapshot(&ctx);
+    kg_printf("[allocator](%s)\n\tparent_allocator:  %p\n\talloc_count:       %lli\n\tfree_count:        %lli\n\tresize_count:      %lli\n\ttotal_allocated:   %lliB\n\ttotal_freed:       %lliB\n\tcurrent_allocated: %lliB\n\tpeak_allocated:    %lliB\n", 
               ctx.name, 
               ctx.parent_allocator,
-              ctx.alloc_count, 
-              ctx.free_count, 
-              ctx.resize_count, 
-              ctx.total_allocated, 
-              ctx.total_freed, 
-              ctx.current_allocated);
+              snapshot.alloc_count, 
+              snapshot.free_count, 
+              snapshot.resize_count, 
+              snapshot.total_allocated, 
+              snapshot.total_freed, 
+              snapshot.current_allocated,
+              snapshot.peak_allocated);
 }
 kg_inline kg_allocator_t kg_allocator_tracking(kg_allocator_tracking_context_t* ctx) {
     kg_assert(ctx);
@@ -751,10 +2191,285 @@ kg_inline kg_allocator_t kg_allocator_tracking(kg_allocator_tracking_context_t*
     kg_assert(ctx->name);
     return (kg_allocator_t){
         .proc = {
-            .alloc    = kg_allocator_tracking_alloc,
-            .free     = kg_allocator_tracking_free,
-            .free_all = kg_allocator_tracking_free_all,
-            .resize   = kg_allocator_tracking_resize,
+            .alloc        = kg_allocator_tracking_alloc,
+            .alloc_uninit = kg_allocator_tracking_alloc_uninit,
+            .alloc_batch  = kg_allocator_tracking_alloc_batch,
+            .free         = kg_allocator_tracking_free,
+            .free_batch   = kg_allocator_tracking_free_batch,
+            .free_all     = kg_allocator_tracking_free_all,
+            .resize       = kg_allocator_tracking_resize,
+        },
+        .context = ctx,
+    };
+}
+
+typedef struct kg_allocator_profile_header_t {
+    isize site;
+    isize _padding;
+} kg_allocator_profile_header_t;
+
+kg_static _Thread_local const char* kg_allocator_profile_site_file_ = null;
+kg_static _Thread_local isize       kg_allocator_profile_site_line_ = 0;
+kg_static _Thread_local isize       kg_allocator_profile_site_depth_ = 0;
+
+// While an entry point has pushed its caller's site the inner sites are ignored.
+void kg_allocator_profile_set_site(const char* file, isize line) {
+    if (kg_allocator_profile_site_depth_ == 0) {
+        kg_allocator_profile_site_file_ = file;
+        kg_allocator_profile_site_line_ = line;
+    }
+}
+void kg_allocator_profile_push_site(const char* file, isize line) {
+    kg_allocator_profile_set_site(file, line);
+    kg_allocator_profile_site_depth_++;
+}
+void* kg_allocator_profile_pop_site(void* ptr) {
+    if (--kg_allocator_profile_site_depth_ == 0) {
+        kg_allocator_profile_site_file_ = null;
+        kg_allocator_profile_site_line_ = 0;
+    }
+    return ptr;
+}
+kg_static void kg_allocator_profile_lock_(kg_allocator_profile_context_t* ctx) {
+    i32 expected = 0;
+    while (!kg_atomic_cas(&ctx->lock, &expected, 1)) {
+        expected = 0;
+    }
+}
+kg_static void kg_allocator_profile_unlock_(kg_allocator_profile_context_t* ctx) {
+    kg_atomic_store(&ctx->lock, 0);
+}
+// The last table entry is kept for the unknown site, so sites past the table size
+// are still accounted for there and counted as dropped.
+kg_static isize kg_allocator_profile_site_lookup_(kg_allocator_profile_context_t* ctx, const char* file, isize line) {
+    u64 hash = (kg_cast(u64)kg_cast(usize)file ^ (kg_cast(u64)line << 32)) * 0x9e3779b97f4a7c15ull;
+    isize mask = 2 * KG_ALLOCATOR_PROFILE_SITES_LEN - 1;
+    isize slot = kg_cast(isize)(hash >> 32) & mask;
+    for (;;) {
+        u16 entry = ctx->table[slot];
+        if (entry == 0) {
+            break;
+        }
+        kg_allocator_profile_site_t* site = &ctx->sites[entry - 1];
+        if (site->file == file && site->line == line) {
+            return entry - 1;
+        }
+        slot = (slot + 1) & mask;
+    }
+    isize out_index = -1;
+    if (ctx->sites_len < KG_ALLOCATOR_PROFILE_SITES_LEN - 1 || file == null) {
+        out_index = ctx->sites_len++;
+        ctx->sites[out_index] = (kg_allocator_profile_site_t){
+            .file = file,
+            .line = line,
+        };
+        ctx->table[slot] = kg_cast(u16)(out_index + 1);
+    }
+    return out_index;
+}
+// Consumes the site set on this thread by the last alloc/resize macro, a site pushed
+// by an entry point stays until the entry point returns.
+kg_static isize kg_allocator_profile_site_index_(kg_allocator_profile_context_t* ctx) {
+    const char* file = kg_allocator_profile_site_file_;
+    isize line = kg_allocator_profile_site_line_;
+    if (kg_allocator_profile_site_depth_ == 0) {
+        kg_allocator_profile_site_file_ = null;
+        kg_allocator_profile_site_line_ = 0;
+    }
+    isize out_index = kg_allocator_profile_site_lookup_(ctx, file, line);
+    if (out_index < 0) {
+        ctx->dropped_count++;
+        out_index = kg_allocator_profile_site_lookup_(ctx, null, 0);
+    }
+    return out_index;
+}
+kg_static void* kg_allocator_profile_alloc_(kg_allocator_t* a, isize size, b32 zero) {
+    kg_allocator_profile_context_t* ctx = kg_cast(kg_allocator_profile_context_t*)a->context;
+    kg_allocator_profile_lock_(ctx);
+    isize index = kg_allocator_profile_site_index_(ctx);
+    kg_allocator_profile_unlock_(ctx);
+    void* out_ptr = null;
+    isize mem_size = kg_sizeof(kg_allocator_profile_header_t) + size;
+    kg_allocator_profile_header_t* h = zero ? kg_allocator_alloc(ctx->parent_allocator, mem_size) : kg_allocator_alloc_uninit(ctx->parent_allocator, mem_size);
+    if (h) {
+        h->site = index;
+        kg_allocator_profile_lock_(ctx);
+        kg_allocator_profile_site_t* site = &ctx->sites[index];
+        site->alloc_count++;
+        site->total_allocated += size;
+        site->live_count++;
+        site->live_allocated += size;
+        kg_allocator_profile_unlock_(ctx);
+        out_ptr = h + 1;
+    }
+    return out_ptr;
+}
+void* kg_allocator_profile_alloc(kg_allocator_t* a, isize size) {
+    return kg_allocator_profile_alloc_(a, size, true);
+}
+void* kg_allocator_profile_alloc_uninit(kg_allocator_t* a, isize size) {
+    return kg_allocator_profile_alloc_(a, size, false);
+}
+b32 kg_allocator_profile_alloc_batch(kg_allocator_t* a, isize size, isize n, void** out_ptrs) {
+    kg_allocator_profile_context_t* ctx = kg_cast(kg_allocator_profile_context_t*)a->context;
+    kg_allocator_profile_lock_(ctx);
+    isize index = kg_allocator_profile_site_index_(ctx);
+    kg_allocator_profile_unlock_(ctx);
+    b32 out_ok = kg_allocator_alloc_batch(ctx->parent_allocator, kg_sizeof(kg_allocator_profile_header_t) + size, n, out_ptrs);
+    if (out_ok) {
+        for (isize i = 0; i < n; i++) {
+            kg_allocator_profile_header_t* h = kg_cast(kg_allocator_profile_header_t*)out_ptrs[i];
+            h->site = index;
+            out_ptrs[i] = h + 1;
+        }
+        kg_allocator_profile_lock_(ctx);
+        kg_allocator_profile_site_t* site = &ctx->sites[index];
+        site->alloc_count += n;
+        site->total_allocated += size * n;
+        site->live_count += n;
+        site->live_allocated += size * n;
+        kg_allocator_profile_unlock_(ctx);
+    }
+    return out_ok;
+}
+void kg_allocator_profile_free(kg_allocator_t* a, void* ptr, isize size) {
+    kg_allocator_profile_context_t* ctx = kg_cast(kg_allocator_profile_context_t*)a->context;
+    if (ptr) {
+        kg_allocator_profile_header_t* h = kg_cast(kg_allocator_profile_header_t*)ptr - 1;
+        kg_allocator_profile_lock_(ctx);
+        kg_allocator_profile_site_t* site = &ctx->sites[h->site];
+        site->free_count++;
+        site->live_count--;
+        site->live_allocated -= size;
+        kg_allocator_profile_unlock_(ctx);
+        kg_allocator_free(ctx->parent_allocator, h, kg_sizeof(kg_allocator_profile_header_t) + size);
+    }
+}
+// The parent's blocks are collected in chunks on the stack, ptrs is left untouched.
+void kg_allocator_profile_free_batch(kg_allocator_t* a, void** ptrs, isize n, isize size) {
+    kg_allocator_profile_context_t* ctx = kg_cast(kg_allocator_profile_context_t*)a->context;
+    void* blocks[KG_ALLOCATOR_PROFILE_FREE_CHUNK_LEN];
+    isize i = 0;
+    while (i < n) {
+        isize blocks_len = 0;
+        kg_allocator_profile_lock_(ctx);
+        for (; i < n && blocks_len < KG_ALLOCATOR_PROFILE_FREE_CHUNK_LEN; i++) {
+            if (ptrs[i]) {
+                kg_allocator_profile_header_t* h = kg_cast(kg_allocator_profile_header_t*)ptrs[i] - 1;
+                kg_allocator_profile_site_t* site = &ctx->sites[h->site];
+                site->free_count++;
+                site->live_count--;
+                site->live_allocated -= size;
+                blocks[blocks_len++] = h;
+            }
+        }
+        kg_allocator_profile_unlock_(ctx);
+        kg_allocator_free_batch(ctx->parent_allocator, blocks, blocks_len, kg_sizeof(kg_allocator_profile_header_t) + size);
+    }
+}
+void kg_allocator_profile_free_all(kg_allocator_t* a, b32 clear) {
+    kg_allocator_profile_context_t* ctx = kg_cast(kg_allocator_profile_context_t*)a->context;
+    kg_allocator_profile_lock_(ctx);
+    for (isize i = 0; i < ctx->sites_len; i++) {
+        ctx->sites[i].live_count = 0;
+        ctx->sites[i].live_allocated = 0;
+    }
+    kg_allocator_profile_unlock_(ctx);
+    kg_allocator_free_all(ctx->parent_allocator, clear);
+}
+// The live object moves to the resizing site, so growth is charged where it happens.
+void* kg_allocator_profile_resize(kg_allocator_t* a, void* ptr, isize old_size, isize new_size) {
+    kg_allocator_profile_context_t* ctx = kg_cast(kg_allocator_profile_context_t*)a->context;
+    void* out_ptr = null;
+    if (ptr) {
+        kg_allocator_profile_lock_(ctx);
+        isize index = kg_allocator_profile_site_index_(ctx);
+        kg_allocator_profile_unlock_(ctx);
+        kg_allocator_profile_header_t* h = kg_cast(kg_allocator_profile_header_t*)ptr - 1;
+        isize old_index = h->site;
+        h = kg_allocator_resize(ctx->parent_allocator, h, kg_sizeof(kg_allocator_profile_header_t) + old_size, kg_sizeof(kg_allocator_profile_header_t) + new_size);
+        if (h) {
+            h->site = index;
+            kg_allocator_profile_lock_(ctx);
+            kg_allocator_profile_site_t* old_site = &ctx->sites[old_index];
+            old_site->live_count--;
+            old_site->live_allocated -= old_size;
+            kg_allocator_profile_site_t* site = &ctx->sites[index];
+            site->resize_count++;
+            site->total_allocated += new_size;
+            site->live_count++;
+            site->live_allocated += new_size;
+            kg_allocator_profile_unlock_(ctx);
+            out_ptr = h + 1;
+        }
+    }
+    return out_ptr;
+}
+kg_static isize kg_allocator_profile_site_key_(const kg_allocator_profile_site_t* site, kg_allocator_profile_sort_t sort) {
+    switch (sort) {
+        case KG_ALLOCATOR_PROFILE_SORT_BYTES: return site->total_allocated;
+        case KG_ALLOCATOR_PROFILE_SORT_COUNT: return site->alloc_count + site->resize_count;
+        case KG_ALLOCATOR_PROFILE_SORT_LIVE:  return site->live_allocated;
+    }
+    return 0;
+}
+isize kg_allocator_profile_sites(kg_allocator_profile_context_t* ctx, kg_allocator_profile_site_t* out, isize out_cap, kg_allocator_profile_sort_t sort) {
+    isize out_len = 0;
+    kg_allocator_profile_lock_(ctx);
+    for (isize i = 0; i < ctx->sites_len; i++) {
+        kg_allocator_profile_site_t site = ctx->sites[i];
+        isize key = kg_allocator_profile_site_key_(&site, sort);
+        if (key == 0) {
+            continue;
+        }
+        isize j = kg_min(out_len, out_cap);
+        while (j > 0 && kg_allocator_profile_site_key_(&out[j - 1], sort) < key) {
+            if (j < out_cap) {
+                out[j] = out[j - 1];
+            }
+            j--;
+        }
+        if (j < out_cap) {
+            out[j] = site;
+            out_len = kg_min(out_len + 1, out_cap);
+        }
+    }
+    kg_allocator_profile_unlock_(ctx);
+    return out_len;
+}
+void kg_allocator_profile_report(kg_allocator_profile_context_t* ctx, kg_allocator_profile_sort_t sort, isize limit) {
+    isize cap = kg_clamp(limit, 0, KG_ALLOCATOR_PROFILE_SITES_LEN);
+    kg_allocator_profile_site_t* sites = kg_allocator_alloc_array(ctx->parent_allocator, kg_allocator_profile_site_t, cap);
+    if (sites) {
+        isize sites_len = kg_allocator_profile_sites(ctx, sites, cap, sort);
+        kg_printf("[allocator profile] %lli sites, %lli dropped\n", ctx->sites_len, ctx->dropped_count);
+        kg_printf("%12s %12s %14s %10s %14s  %s\n", "allocs", "resizes", "bytes", "live", "live bytes", "site");
+        for (isize i = 0; i < sites_len; i++) {
+            kg_allocator_profile_site_t* site = &sites[i];
+            kg_printf("%12lli %12lli %14lli %10lli %14lli  %s:%lli\n",
+                      site->alloc_count,
+                      site->resize_count,
+                      site->total_allocated,
+                      site->live_count,
+                      site->live_allocated,
+                      site->file ? site->file : "<unknown>",
+                      site->line);
+        }
+        kg_allocator_free(ctx->parent_allocator, sites, kg_sizeof(kg_allocator_profile_site_t) * cap);
+    }
+}
+kg_inline kg_allocator_t kg_allocator_profile(kg_allocator_profile_context_t* ctx) {
+    kg_assert(ctx);
+    kg_assert(ctx->parent_allocator);
+    return (kg_allocator_t){
+        .proc = {
+            .alloc        = kg_allocator_profile_alloc,
+            .alloc_uninit = kg_allocator_profile_alloc_uninit,
+            .alloc_batch  = kg_allocator_profile_alloc_batch,
+            .free         = kg_allocator_profile_free,
+            .free_batch   = kg_allocator_profile_free_batch,
+            .free_all     = kg_allocator_profile_free_all,
+            .resize       = kg_allocator_profile_resize,
         },
         .context = ctx,
     };
@@ -767,114 +2482,954 @@ b32 kg_arena_create(kg_arena_t* a, kg_allocator_t* allocator, isize max_size) {
         .real_ptr       = kg_allocator_alloc(allocator, max_size),
         .max_size       = max_size,
         .allocated_size = 0,
+        .kind           = KG_ARENA_KIND_FIXED,
     };
     if (arena.real_ptr) {
         *a = arena;
         out_ok = true;
     }
-    return out_ok;
+    return out_ok;
+}
+kg_static kg_arena_block_t* kg_arena_block_create_(kg_allocator_t* allocator, isize size, kg_arena_block_t* prev) {
+    kg_arena_block_t* out = kg_cast(kg_arena_block_t*)kg_allocator_alloc(allocator, kg_sizeof(kg_arena_block_t) + size);
+    if (out) {
+        out->prev = prev;
+        out->size = size;
+    }
+    return out;
+}
+kg_static void kg_arena_block_destroy_(kg_allocator_t* allocator, kg_arena_block_t* block) {
+    kg_allocator_free(allocator, block, kg_sizeof(kg_arena_block_t) + block->size);
+}
+b32 kg_arena_create_chained(kg_arena_t* a, kg_allocator_t* allocator, isize block_size) {
+    b32 out_ok = false;
+    kg_arena_block_t* block = kg_arena_block_create_(allocator, block_size, null);
+    if (block) {
+        *a = (kg_arena_t){
+            .allocator      = allocator,
+            .real_ptr       = block + 1,
+            .max_size       = block_size,
+            .allocated_size = 0,
+            .kind           = KG_ARENA_KIND_CHAINED,
+            .block          = block,
+            .block_size     = block_size,
+        };
+        out_ok = true;
+    }
+    return out_ok;
+}
+b32 kg_arena_create_virtual(kg_arena_t* a, isize reserve_size) {
+    b32 out_ok = false;
+    isize max_size = kg_align_up(reserve_size, kg_vm_page_size());
+    void* real_ptr = kg_vm_reserve(max_size);
+    if (real_ptr) {
+        *a = (kg_arena_t){
+            .allocator      = null,
+            .real_ptr       = real_ptr,
+            .max_size       = max_size,
+            .allocated_size = 0,
+            .kind           = KG_ARENA_KIND_VIRTUAL,
+            .committed_size = 0,
+        };
+        out_ok = true;
+    }
+    return out_ok;
+}
+kg_static kg_inline isize kg_arena_padding_(const kg_arena_t* a, isize align) {
+    usize addr = kg_cast(usize)a->real_ptr + kg_cast(usize)a->allocated_size;
+    return kg_cast(isize)(kg_align_up(addr, kg_cast(usize)align) - addr);
+}
+kg_static b32 kg_arena_ensure_available_(kg_arena_t* a, isize size, isize align, isize* out_padding) {
+    isize padding = kg_arena_padding_(a, align);
+    b32 out_ok = kg_arena_available(a) >= padding + size;
+    if (!out_ok) {
+        switch (a->kind) {
+            case KG_ARENA_KIND_CHAINED: {
+                kg_arena_block_t* block = kg_arena_block_create_(a->allocator, kg_max(a->block_size, size + align - 1), a->block);
+                if (block) {
+                    a->prev_blocks_allocated += a->allocated_size;
+                    a->block = block;
+                    a->real_ptr = block + 1;
+                    a->max_size = block->size;
+                    a->allocated_size = 0;
+                    a->dirty_size = 0;
+                    a->released_start = 0;
+                    a->released_end = 0;
+                    padding = kg_arena_padding_(a, align);
+                    out_ok = true;
+                }
+            } break;
+            default:
+                break;
+        }
+    }
+    if (out_ok && a->kind == KG_ARENA_KIND_VIRTUAL && a->allocated_size + padding + size > a->committed_size) {
+        isize new_committed_size = kg_min(kg_align_up(a->allocated_size + padding + size, KG_ARENA_COMMIT_SIZE), a->max_size);
+        out_ok = kg_vm_commit(kg_cast(u8*)a->real_ptr + a->committed_size, new_committed_size - a->committed_size);
+        if (out_ok) {
+            a->committed_size = new_committed_size;
+        }
+    }
+    *out_padding = padding;
+    return out_ok;
+}
+// Bytes below dirty_size were written since the last reset, bytes in the released range were
+// handed back with madvise and may not read as zero. Both are zeroed lazily when reused.
+kg_static void kg_arena_zero_range_(kg_arena_t* a, isize start, isize end) {
+    u8* base = kg_cast(u8*)a->real_ptr;
+    isize dirty_end = kg_min(end, a->dirty_size);
+    if (start < dirty_end) {
+        kg_mem_zero(base + start, dirty_end - start);
+    }
+    isize released_start = kg_max(start, kg_max(a->released_start, a->dirty_size));
+    isize released_end = kg_min(end, a->released_end);
+    if (released_start < released_end) {
+        kg_mem_zero(base + released_start, released_end - released_start);
+    }
+}
+kg_static void kg_arena_mark_dirty_(kg_arena_t* a, isize end) {
+    a->dirty_size = kg_max(a->dirty_size, end);
+    a->released_start = kg_max(a->released_start, a->dirty_size);
+}
+kg_static void* kg_arena_alloc_align_(kg_arena_t* a, isize size, isize align, b32 zero) {
+    void* out = null;
+    isize padding = 0;
+    if (a && size > 0 && kg_is_power_of_two(align)) {
+        if (kg_arena_ensure_available_(a, size, align, &padding)) {
+            isize start = a->allocated_size + padding;
+            isize end = start + size;
+            out = kg_cast(u8*)a->real_ptr + start;
+            if (zero) {
+                kg_arena_zero_range_(a, start, end);
+            }
+            a->allocated_size = end;
+            kg_arena_mark_dirty_(a, end);
+        }
+    }
+    return out;
+}
+kg_inline void* kg_arena_alloc(kg_arena_t* a, isize size) {
+    return kg_arena_alloc_align_(a, size, KG_DEFAULT_ALIGNMENT, true);
+}
+kg_inline void* kg_arena_alloc_uninit(kg_arena_t* a, isize size) {
+    return kg_arena_alloc_align_(a, size, KG_DEFAULT_ALIGNMENT, false);
+}
+kg_inline void* kg_arena_alloc_align(kg_arena_t* a, isize size, isize align) {
+    return kg_arena_alloc_align_(a, size, align, true);
+}
+void* kg_arena_resize(kg_arena_t* a, void* ptr, isize old_size, isize new_size) {
+    void* out = null;
+    if (a && ptr == null) {
+        out = kg_arena_alloc(a, new_size);
+    } else if (a && new_size > 0) {
+        u8* top = kg_cast(u8*)a->real_ptr + a->allocated_size;
+        b32 is_last = kg_cast(u8*)ptr + old_size == top && kg_cast(u8*)ptr >= kg_cast(u8*)a->real_ptr;
+        isize delta = new_size - old_size;
+        isize padding = 0;
+        if (delta <= 0) {
+            if (is_last) {
+                a->allocated_size += delta;
+            }
+            a->resize_in_place_count++;
+            out = ptr;
+        } else if (is_last && kg_arena_available(a) >= delta && kg_arena_ensure_available_(a, delta, 1, &padding)) {
+            isize start = a->allocated_size;
+            isize end = start + delta;
+            kg_arena_zero_range_(a, start, end);
+            a->allocated_size = end;
+            kg_arena_mark_dirty_(a, end);
+            a->resize_in_place_count++;
+            out = ptr;
+        } else {
+            out = kg_arena_alloc_uninit(a, new_size);
+            if (out) {
+                kg_mem_copy(out, ptr, old_size);
+                kg_mem_zero(kg_cast(u8*)out + old_size, delta);
+                a->resize_copy_count++;
+            }
+        }
+    }
+    return out;
+}
+kg_inline isize kg_arena_allocated(const kg_arena_t* a) {
+    return a ? a->prev_blocks_allocated + a->allocated_size : 0;
+}
+kg_inline isize kg_arena_available(const kg_arena_t* a) {
+    isize out = 0;
+    if (a && a->max_size > a->allocated_size) {
+        out = a->max_size - a->allocated_size;
+    }
+    return out;
+}
+kg_inline isize kg_arena_mem_size(const kg_arena_t* a) {
+    isize out = 0;
+    if (a) {
+        switch (a->kind) {
+            case KG_ARENA_KIND_CHAINED:
+                for (kg_arena_block_t* block = a->block; block; block = block->prev) {
+                    out += block->size;
+                }
+                break;
+            case KG_ARENA_KIND_VIRTUAL:
+                out = a->committed_size;
+                break;
+            default:
+                out = a->max_size;
+                break;
+        }
+    }
+    return out;
+}
+void kg_arena_reset(kg_arena_t* a) {
+    if (a) {
+        kg_arena_reset_no_zero(a);
+        kg_mem_zero(a->real_ptr, a->dirty_size);
+        a->dirty_size = 0;
+    }
+}
+void kg_arena_reset_no_zero(kg_arena_t* a) {
+    if (a) {
+        if (a->kind == KG_ARENA_KIND_CHAINED) {
+            while (a->block->prev) {
+                kg_arena_block_t* prev = a->block->prev;
+                a->block->prev = prev->prev;
+                kg_arena_block_destroy_(a->allocator, prev);
+            }
+            a->prev_blocks_allocated = 0;
+        }
+        a->allocated_size = 0;
+    }
+}
+void kg_arena_release(kg_arena_t* a, isize keep_size) {
+    if (a) {
+        kg_arena_reset_no_zero(a);
+        isize page_size = kg_vm_page_size();
+        usize base = kg_cast(usize)a->real_ptr;
+        if (a->kind == KG_ARENA_KIND_VIRTUAL) {
+            isize keep_committed = kg_min(kg_align_up(kg_max(keep_size, 0), KG_ARENA_COMMIT_SIZE), a->committed_size);
+            if (keep_committed < a->committed_size &&
+                kg_vm_decommit(kg_cast(u8*)a->real_ptr + keep_committed, a->committed_size - keep_committed)) {
+                a->committed_size = keep_committed;
+                a->dirty_size = kg_min(a->dirty_size, keep_committed);
+            }
+        } else {
+            // The block comes from an arbitrary allocator, so the pages are not guaranteed to read
+            // back as zero after madvise (shared or file backed mappings). They leave dirty_size and
+            // go to the released range instead, which reset never touches.
+            usize release_start = kg_align_up(base + kg_cast(usize)kg_max(keep_size, 0), kg_cast(usize)page_size);
+            usize release_end = (base + kg_cast(usize)a->max_size) & ~(kg_cast(usize)page_size - 1);
+            if (release_start < release_end &&
+                madvise(kg_cast(void*)release_start, release_end - release_start, MADV_DONTNEED) == 0) {
+                isize start = kg_cast(isize)(release_start - base);
+                isize end = kg_max(kg_cast(isize)(release_end - base), a->dirty_size);
+                if (a->released_start < a->released_end) {
+                    start = kg_min(start, a->released_start);
+                    end = kg_max(end, a->released_end);
+                }
+                a->dirty_size = kg_min(a->dirty_size, start);
+                a->released_start = start;
+                a->released_end = end;
+            }
+        }
+    }
+}
+void kg_arena_destroy(kg_arena_t* a) {
+    if (a) {
+        switch (a->kind) {
+            case KG_ARENA_KIND_CHAINED:
+                while (a->block) {
+                    kg_arena_block_t* prev = a->block->prev;
+                    kg_arena_block_destroy_(a->allocator, a->block);
+                    a->block = prev;
+                }
+                break;
+            case KG_ARENA_KIND_VIRTUAL:
+                kg_vm_release(a->real_ptr, a->max_size);
+                break;
+            default:
+                kg_allocator_free(a->allocator, a->real_ptr, kg_arena_mem_size(a));
+                break;
+        }
+        kg_mem_zero(a, kg_sizeof(kg_arena_t));
+    }
+}
+kg_arena_temp_t kg_arena_temp_begin(kg_arena_t* a) {
+    return (kg_arena_temp_t){
+        .arena                 = a,
+        .block                 = a->block,
+        .allocated_size        = a->allocated_size,
+        .prev_blocks_allocated = a->prev_blocks_allocated,
+    };
+}
+void kg_arena_temp_end(kg_arena_temp_t t) {
+    kg_arena_t* a = t.arena;
+    if (a) {
+        if (a->kind == KG_ARENA_KIND_CHAINED && a->block != t.block) {
+            while (a->block != t.block) {
+                kg_arena_block_t* prev = a->block->prev;
+                kg_arena_block_destroy_(a->allocator, a->block);
+                a->block = prev;
+            }
+            a->real_ptr = a->block + 1;
+            a->max_size = a->block->size;
+            a->dirty_size = a->max_size;
+            a->released_start = 0;
+            a->released_end = 0;
+        }
+        a->allocated_size = t.allocated_size;
+        a->prev_blocks_allocated = t.prev_blocks_allocated;
+    }
+}
+
+void* kg_allocator_temp_alloc(kg_allocator_t* a, isize size) {
+    kg_arena_t* arena = kg_cast(kg_arena_t*)a->context;
+    return kg_arena_alloc(arena, size);
+}
+void* kg_allocator_temp_alloc_uninit(kg_allocator_t* a, isize size) {
+    kg_arena_t* arena = kg_cast(kg_arena_t*)a->context;
+    return kg_arena_alloc_uninit(arena, size);
+}
+// One arena allocation is split into n blocks, each aligned like a single alloc.
+b32 kg_allocator_temp_alloc_batch(kg_allocator_t* a, isize size, isize n, void** out_ptrs) {
+    kg_arena_t* arena = kg_cast(kg_arena_t*)a->context;
+    isize stride = kg_align_up(size, KG_DEFAULT_ALIGNMENT);
+    u8* block = n > 0 ? kg_arena_alloc(arena, stride * n) : null;
+    if (block) {
+        for (isize i = 0; i < n; i++) {
+            out_ptrs[i] = block + i * stride;
+        }
+    }
+    return block != null || n == 0;
+}
+void kg_allocator_temp_free(kg_allocator_t* a, void* ptr, isize size) {
+    kg_cast(void)a;
+    kg_cast(void)ptr;
+    kg_cast(void)size;
+}
+void kg_allocator_temp_free_batch(kg_allocator_t* a, void** ptrs, isize n, isize size) {
+    kg_cast(void)a;
+    kg_cast(void)ptrs;
+    kg_cast(void)n;
+    kg_cast(void)size;
+}
+void kg_allocator_temp_free_all(kg_allocator_t* a, b32 clear) {
+    kg_arena_t* arena = kg_cast(kg_arena_t*)a->context;
+    if (clear) {
+        kg_arena_reset(arena);
+    } else {
+        kg_arena_destroy(arena);
+    }
+}
+void* kg_allocator_temp_resize(kg_allocator_t* a, void* ptr, isize old_size, isize new_size) {
+    kg_arena_t* arena = kg_cast(kg_arena_t*)a->context;
+    return kg_arena_resize(arena, ptr, old_size, new_size);
+}
+kg_inline kg_allocator_t kg_allocator_temp(kg_arena_t* a) {
+    return (kg_allocator_t){
+        .proc = {
+            .alloc        = kg_allocator_temp_alloc,
+            .alloc_uninit = kg_allocator_temp_alloc_uninit,
+            .alloc_batch  = kg_allocator_temp_alloc_batch,
+            .free         = kg_allocator_temp_free,
+            .free_batch   = kg_allocator_temp_free_batch,
+            .free_all     = kg_allocator_temp_free_all,
+            .resize       = kg_allocator_temp_resize,
+        },
+        .context = a,
+    };
+}
+
+b32 kg_object_pool_create(kg_object_pool_t* p, kg_allocator_t* allocator, isize slot_size, isize slots_per_slab) {
+    b32 out_ok = false;
+    if (p && allocator && slot_size > 0 && slots_per_slab > 0) {
+        isize slot_align = slot_size >= KG_DEFAULT_ALIGNMENT ? KG_DEFAULT_ALIGNMENT : kg_sizeof(void*);
+        *p = (kg_object_pool_t){
+            .allocator      = allocator,
+            .slot_size      = kg_align_up(kg_max(slot_size, kg_sizeof(void*)), slot_align),
+            .slots_per_slab = slots_per_slab,
+        };
+        out_ok = kg_object_pool_alloc(p) != null;
+        kg_object_pool_reset(p);
+    }
+    return out_ok;
+}
+kg_static kg_inline isize kg_object_pool_slab_mem_size_(const kg_object_pool_t* p, const kg_object_pool_slab_t* slab) {
+    return kg_sizeof(kg_object_pool_slab_t) + slab->slots_len * p->slot_size;
+}
+kg_static b32 kg_object_pool_next_slab_(kg_object_pool_t* p) {
+    b32 out_ok = true;
+    if (p->slab && p->slab->next) {
+        p->slab = p->slab->next;
+    } else {
+        kg_object_pool_slab_t* slab = kg_allocator_alloc(p->allocator, kg_sizeof(kg_object_pool_slab_t) + p->slots_per_slab * p->slot_size);
+        if (slab) {
+            slab->next = null;
+            slab->slots_len = p->slots_per_slab;
+            if (p->slab) {
+                p->slab->next = slab;
+            } else {
+                p->slabs = slab;
+            }
+            p->slab = slab;
+            p->slabs_len++;
+        } else {
+            out_ok = false;
+        }
+    }
+    if (out_ok) {
+        p->slab_used = 0;
+    }
+    return out_ok;
+}
+void* kg_object_pool_alloc_uninit(kg_object_pool_t* p) {
+    void* out = null;
+    if (p->free_list) {
+        out = p->free_list;
+        p->free_list = *kg_cast(void**)out;
+    } else if ((p->slab && p->slab_used < p->slab->slots_len) || kg_object_pool_next_slab_(p)) {
+        out = kg_cast(u8*)(p->slab + 1) + p->slab_used * p->slot_size;
+        p->slab_used++;
+    }
+    if (out) {
+        p->allocated_count++;
+    }
+    return out;
+}
+void* kg_object_pool_alloc(kg_object_pool_t* p) {
+    void* out = kg_object_pool_alloc_uninit(p);
+    if (out) {
+        kg_mem_zero(out, p->slot_size);
+    }
+    return out;
+}
+void kg_object_pool_free(kg_object_pool_t* p, void* ptr) {
+    if (ptr) {
+        *kg_cast(void**)ptr = p->free_list;
+        p->free_list = ptr;
+        p->allocated_count--;
+    }
+}
+void kg_object_pool_reset(kg_object_pool_t* p) {
+    if (p) {
+        p->slab = p->slabs;
+        p->slab_used = 0;
+        p->free_list = null;
+        p->allocated_count = 0;
+    }
+}
+void kg_object_pool_release(kg_object_pool_t* p) {
+    if (p) {
+        while (p->slabs) {
+            kg_object_pool_slab_t* next = p->slabs->next;
+            kg_allocator_free(p->allocator, p->slabs, kg_object_pool_slab_mem_size_(p, p->slabs));
+            p->slabs = next;
+        }
+        p->slabs_len = 0;
+        kg_object_pool_reset(p);
+    }
+}
+kg_inline isize kg_object_pool_mem_size(const kg_object_pool_t* p) {
+    return p ? p->slabs_len * (kg_sizeof(kg_object_pool_slab_t) + p->slots_per_slab * p->slot_size) : 0;
+}
+void kg_object_pool_destroy(kg_object_pool_t* p) {
+    if (p) {
+        kg_object_pool_release(p);
+        kg_mem_zero(p, kg_sizeof(kg_object_pool_t));
+    }
+}
+
+void* kg_allocator_object_pool_alloc(kg_allocator_t* a, isize size) {
+    kg_object_pool_t* p = kg_cast(kg_object_pool_t*)a->context;
+    return size <= p->slot_size ? kg_object_pool_alloc(p) : null;
+}
+void* kg_allocator_object_pool_alloc_uninit(kg_allocator_t* a, isize size) {
+    kg_object_pool_t* p = kg_cast(kg_object_pool_t*)a->context;
+    return size <= p->slot_size ? kg_object_pool_alloc_uninit(p) : null;
+}
+b32 kg_allocator_object_pool_alloc_batch(kg_allocator_t* a, isize size, isize n, void** out_ptrs) {
+    kg_object_pool_t* p = kg_cast(kg_object_pool_t*)a->context;
+    b32 out_ok = size <= p->slot_size;
+    for (isize i = 0; out_ok && i < n; i++) {
+        out_ptrs[i] = kg_object_pool_alloc(p);
+        if (!out_ptrs[i]) {
+            while (i > 0) {
+                kg_object_pool_free(p, out_ptrs[--i]);
+            }
+            out_ok = false;
+        }
+    }
+    return out_ok;
+}
+void kg_allocator_object_pool_free(kg_allocator_t* a, void* ptr, isize size) {
+    kg_cast(void)size;
+    kg_object_pool_t* p = kg_cast(kg_object_pool_t*)a->context;
+    kg_object_pool_free(p, ptr);
+}
+void kg_allocator_object_pool_free_batch(kg_allocator_t* a, void** ptrs, isize n, isize size) {
+    kg_cast(void)size;
+    kg_object_pool_t* p = kg_cast(kg_object_pool_t*)a->context;
+    for (isize i = 0; i < n; i++) {
+        kg_object_pool_free(p, ptrs[i]);
+    }
+}
+void kg_allocator_object_pool_free_all(kg_allocator_t* a, b32 clear) {
+    kg_object_pool_t* p = kg_cast(kg_object_pool_t*)a->context;
+    if (clear) {
+        kg_object_pool_reset(p);
+    } else {
+        kg_object_pool_release(p);
+    }
+}
+void* kg_allocator_object_pool_resize(kg_allocator_t* a, void* ptr, isize old_size, isize new_size) {
+    kg_cast(void)old_size;
+    kg_object_pool_t* p = kg_cast(kg_object_pool_t*)a->context;
+    void* out = null;
+    if (ptr == null) {
+        out = kg_allocator_object_pool_alloc(a, new_size);
+    } else if (new_size <= p->slot_size) {
+        out = ptr;
+    }
+    return out;
+}
+kg_inline kg_allocator_t kg_allocator_object_pool(kg_object_pool_t* p) {
+    return (kg_allocator_t){
+        .proc = {
+            .alloc        = kg_allocator_object_pool_alloc,
+            .alloc_uninit = kg_allocator_object_pool_alloc_uninit,
+            .alloc_batch  = kg_allocator_object_pool_alloc_batch,
+            .free         = kg_allocator_object_pool_free,
+            .free_batch   = kg_allocator_object_pool_free_batch,
+            .free_all     = kg_allocator_object_pool_free_all,
+            .resize       = kg_allocator_object_pool_resize,
+        },
+        .context = p,
+    };
+}
+
+kg_static const isize kg_heap_class_sizes_[KG_HEAP_CLASSES_LEN] = {
+    16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096,
+};
+b32 kg_heap_create(kg_heap_t* h, kg_allocator_t* allocator) {
+    b32 out_ok = false;
+    if (h && allocator) {
+        *h = (kg_heap_t){
+            .allocator = allocator,
+        };
+        for (isize i = 0; i < KG_HEAP_CLASSES_LEN; i++) {
+            h->classes[i] = (kg_object_pool_t){
+                .allocator      = allocator,
+                .slot_size      = kg_heap_class_sizes_[i],
+                .slots_per_slab = KG_HEAP_SLAB_SIZE / kg_heap_class_sizes_[i],
+            };
+        }
+        out_ok = true;
+    }
+    return out_ok;
+}
+kg_inline isize kg_heap_class_index(isize size) {
+    isize out = -1;
+    if (size <= 64) {
+        out = size > 0 ? (size - 1) / 16 : 0;
+    } else if (size <= KG_HEAP_CLASS_MAX_SIZE) {
+        isize shift = 63 - __builtin_clzll(kg_cast(u64)(size - 1));
+        isize base = kg_cast(isize)1 << shift;
+        out = 4 + 2 * (shift - 6) + (size > base + base / 2 ? 1 : 0);
+    }
+    return out;
+}
+kg_inline isize kg_heap_class_size(isize class_index) {
+    return kg_is_within(class_index, 0, KG_HEAP_CLASSES_LEN - 1) ? kg_heap_class_sizes_[class_index] : 0;
+}
+// Large blocks come straight from the os and are zeroed either way.
+kg_static void* kg_heap_alloc_(kg_heap_t* h, isize size, b32 zero) {
+    void* out = null;
+    isize class_index = kg_heap_class_index(size);
+    if (class_index >= 0) {
+        out = zero ? kg_object_pool_alloc(&h->classes[class_index]) : kg_object_pool_alloc_uninit(&h->classes[class_index]);
+    } else if (size > 0) {
+        isize mem_size = kg_align_up(kg_sizeof(kg_heap_large_t) + size, kg_vm_page_size());
+        kg_heap_large_t* large = kg_cast(kg_heap_large_t*)kg_vm_alloc(mem_size);
+        if (large) {
+            *large = (kg_heap_large_t){
+                .prev     = null,
+                .next     = h->large,
+                .mem_size = mem_size,
+            };
+            if (h->large) {
+                h->large->prev = large;
+            }
+            h->large = large;
+            h->large_count++;
+            out = large + 1;
+        }
+    }
+    return out;
+}
+kg_inline void* kg_heap_alloc(kg_heap_t* h, isize size) {
+    return kg_heap_alloc_(h, size, true);
+}
+kg_inline void* kg_heap_alloc_uninit(kg_heap_t* h, isize size) {
+    return kg_heap_alloc_(h, size, false);
+}
+void kg_heap_free(kg_heap_t* h, void* ptr, isize size) {
+    if (ptr) {
+        isize class_index = kg_heap_class_index(size);
+        if (class_index >= 0) {
+            kg_object_pool_free(&h->classes[class_index], ptr);
+        } else {
+            kg_heap_large_t* large = kg_cast(kg_heap_large_t*)ptr - 1;
+            if (large->prev) {
+                large->prev->next = large->next;
+            } else {
+                h->large = large->next;
+            }
+            if (large->next) {
+                large->next->prev = large->prev;
+            }
+            h->large_count--;
+            kg_vm_release(large, large->mem_size);
+        }
+    }
 }
-void* kg_arena_alloc(kg_arena_t* a, isize size) {
+void* kg_heap_resize(kg_heap_t* h, void* ptr, isize old_size, isize new_size) {
     void* out = null;
-    if (a && size > 0) {
-        isize available = kg_arena_available(a);
-        if (available >= size) {
-            out = kg_cast(u8*)a->real_ptr + a->allocated_size;
-            if (out) {
-                a->allocated_size += size;
+    if (ptr == null) {
+        out = kg_heap_alloc(h, new_size);
+    } else if (kg_heap_class_index(old_size) >= 0 && kg_heap_class_index(old_size) == kg_heap_class_index(new_size)) {
+        out = ptr;
+    } else {
+        out = kg_heap_alloc_uninit(h, new_size);
+        if (out) {
+            kg_mem_copy(out, ptr, kg_min(old_size, new_size));
+            if (new_size > old_size) {
+                kg_mem_zero(kg_cast(u8*)out + old_size, new_size - old_size);
             }
+            kg_heap_free(h, ptr, old_size);
         }
     }
     return out;
 }
-kg_inline isize kg_arena_allocated(const kg_arena_t* a) {
-    return a ? a->allocated_size : 0;
+kg_static void kg_heap_release_large_(kg_heap_t* h) {
+    while (h->large) {
+        kg_heap_large_t* next = h->large->next;
+        kg_vm_release(h->large, h->large->mem_size);
+        h->large = next;
+    }
+    h->large_count = 0;
 }
-kg_inline isize kg_arena_available(const kg_arena_t* a) {
-    isize out = 0;
-    if (a && a->max_size > a->allocated_size) {
-        out = a->max_size - a->allocated_size;
+void kg_heap_reset(kg_heap_t* h) {
+    if (h) {
+        for (isize i = 0; i < KG_HEAP_CLASSES_LEN; i++) {
+            kg_object_pool_reset(&h->classes[i]);
+        }
+        kg_heap_release_large_(h);
     }
-    return out;
 }
-kg_inline isize kg_arena_mem_size(const kg_arena_t* a) {
-    return a ? a->max_size : 0;
+void kg_heap_release(kg_heap_t* h) {
+    if (h) {
+        for (isize i = 0; i < KG_HEAP_CLASSES_LEN; i++) {
+            kg_object_pool_release(&h->classes[i]);
+        }
+        kg_heap_release_large_(h);
+    }
 }
-void kg_arena_reset(kg_arena_t* a) {
-    if (a) {
-        kg_mem_zero(a->real_ptr, kg_arena_mem_size(a));
-        a->allocated_size = 0;
+isize kg_heap_mem_size(const kg_heap_t* h) {
+    isize out = 0;
+    if (h) {
+        for (isize i = 0; i < KG_HEAP_CLASSES_LEN; i++) {
+            out += kg_object_pool_mem_size(&h->classes[i]);
+        }
+        for (kg_heap_large_t* large = h->large; large; large = large->next) {
+            out += large->mem_size;
+        }
     }
+    return out;
 }
-void kg_arena_destroy(kg_arena_t* a) {
-    if (a) {
-        kg_allocator_free(a->allocator, a->real_ptr, kg_arena_mem_size(a));
-        kg_mem_zero(a, kg_sizeof(kg_arena_t));
+void kg_heap_destroy(kg_heap_t* h) {
+    if (h) {
+        kg_heap_release(h);
+        kg_mem_zero(h, kg_sizeof(kg_heap_t));
     }
 }
 
-void* kg_allocator_temp_alloc(kg_allocator_t* a, isize size) {
-    kg_arena_t* arena = kg_cast(kg_arena_t*)a->context;
-    return kg_arena_alloc(arena, size);
+void* kg_allocator_heap_alloc(kg_allocator_t* a, isize size) {
+    return kg_heap_alloc(kg_cast(kg_heap_t*)a->context, size);
 }
-void kg_allocator_temp_free(kg_allocator_t* a, void* ptr, isize size) {
-    kg_cast(void)a;
-    kg_cast(void)ptr;
-    kg_cast(void)size;
+void* kg_allocator_heap_alloc_uninit(kg_allocator_t* a, isize size) {
+    return kg_heap_alloc_uninit(kg_cast(kg_heap_t*)a->context, size);
 }
-void kg_allocator_temp_free_all(kg_allocator_t* a, b32 clear) {
-    kg_arena_t* arena = kg_cast(kg_arena_t*)a->context;
+// The size class is looked up once, small blocks then come straight from its pool.
+b32 kg_allocator_heap_alloc_batch(kg_allocator_t* a, isize size, isize n, void** out_ptrs) {
+    kg_heap_t* h = kg_cast(kg_heap_t*)a->context;
+    isize class_index = kg_heap_class_index(size);
+    b32 out_ok = true;
+    for (isize i = 0; i < n; i++) {
+        out_ptrs[i] = class_index >= 0 ? kg_object_pool_alloc(&h->classes[class_index]) : kg_heap_alloc(h, size);
+        if (!out_ptrs[i]) {
+            while (i > 0) {
+                kg_heap_free(h, out_ptrs[--i], size);
+            }
+            out_ok = false;
+            break;
+        }
+    }
+    return out_ok;
+}
+void kg_allocator_heap_free(kg_allocator_t* a, void* ptr, isize size) {
+    kg_heap_free(kg_cast(kg_heap_t*)a->context, ptr, size);
+}
+void kg_allocator_heap_free_batch(kg_allocator_t* a, void** ptrs, isize n, isize size) {
+    kg_heap_t* h = kg_cast(kg_heap_t*)a->context;
+    isize class_index = kg_heap_class_index(size);
+    for (isize i = 0; i < n; i++) {
+        if (class_index >= 0) {
+            kg_object_pool_free(&h->classes[class_index], ptrs[i]);
+        } else {
+            kg_heap_free(h, ptrs[i], size);
+        }
+    }
+}
+void kg_allocator_heap_free_all(kg_allocator_t* a, b32 clear) {
+    kg_heap_t* h = kg_cast(kg_heap_t*)a->context;
     if (clear) {
-        kg_arena_reset(arena);
+        kg_heap_reset(h);
     } else {
-        kg_arena_destroy(arena);
+        kg_heap_release(h);
     }
 }
-void* kg_allocator_temp_resize(kg_allocator_t* a, void* ptr, isize old_size, isize new_size) {
-    kg_cast(void)old_size;
-    void* out_mem = null;
-    kg_arena_t* arena = kg_cast(kg_arena_t*)a->context;
-    out_mem = kg_arena_alloc(arena, new_size);
-    if (out_mem) {
-        kg_mem_copy(out_mem, ptr, old_size);
-    }
-    return out_mem;
+void* kg_allocator_heap_resize(kg_allocator_t* a, void* ptr, isize old_size, isize new_size) {
+    return kg_heap_resize(kg_cast(kg_heap_t*)a->context, ptr, old_size, new_size);
 }
-kg_inline kg_allocator_t kg_allocator_temp(kg_arena_t* a) {
+kg_inline kg_allocator_t kg_allocator_heap(kg_heap_t* h) {
     return (kg_allocator_t){
         .proc = {
-            .alloc    = kg_allocator_temp_alloc,
-            .free     = kg_allocator_temp_free,
-            .free_all = kg_allocator_temp_free_all,
-            .resize   = kg_allocator_temp_resize,
+            .alloc        = kg_allocator_heap_alloc,
+            .alloc_uninit = kg_allocator_heap_alloc_uninit,
+            .alloc_batch  = kg_allocator_heap_alloc_batch,
+            .free         = kg_allocator_heap_free,
+            .free_batch   = kg_allocator_heap_free_batch,
+            .free_all     = kg_allocator_heap_free_all,
+            .resize       = kg_allocator_heap_resize,
         },
-        .context = a,
+        .context = h,
     };
 }
 
+kg_static void kg_quicksort_insertion_(u8* a, isize n, isize stride, kg_compare_fn_t compare_fn) {
+    for (isize i = 1; i < n; i++) {
+        for (isize j = i; j > 0 && compare_fn(a + j * stride, a + (j - 1) * stride) < 0; j--) {
+            kg_mem_swap(a + j * stride, a + (j - 1) * stride, stride);
+        }
+    }
+}
+kg_static void kg_quicksort_sift_down_(u8* a, isize i, isize n, isize stride, kg_compare_fn_t compare_fn) {
+    for (isize child = 2 * i + 1; child < n; child = 2 * i + 1) {
+        if (child + 1 < n && compare_fn(a + child * stride, a + (child + 1) * stride) < 0) {
+            child++;
+        }
+        if (compare_fn(a + i * stride, a + child * stride) >= 0) {
+            break;
+        }
+        kg_mem_swap(a + i * stride, a + child * stride, stride);
+        i = child;
+    }
+}
+kg_static isize kg_quicksort_median3_(u8* a, isize i, isize j, isize k, isize stride, kg_compare_fn_t compare_fn) {
+    u8* x = a + i * stride;
+    u8* y = a + j * stride;
+    u8* z = a + k * stride;
+    return compare_fn(x, y) < 0
+        ? (compare_fn(y, z) < 0 ? j : (compare_fn(x, z) < 0 ? k : i))
+        : (compare_fn(z, y) < 0 ? j : (compare_fn(z, x) < 0 ? k : i));
+}
+// Same introsort as KG_SORT_TYPEDEF but through compare_fn and byte swaps, the pivot is
+// parked at a[0] so partitioning never moves it.
+kg_static void kg_quicksort_intro_(u8* a, isize n, isize stride, kg_compare_fn_t compare_fn, isize depth) {
+    while (n > KG_SORT_INSERTION_THRESHOLD) {
+        if (depth-- == 0) {
+            for (isize i = n / 2 - 1; i >= 0; i--) {
+                kg_quicksort_sift_down_(a, i, n, stride, compare_fn);
+            }
+            for (isize i = n - 1; i > 0; i--) {
+                kg_mem_swap(a, a + i * stride, stride);
+                kg_quicksort_sift_down_(a, 0, i, stride, compare_fn);
+            }
+            return;
+        }
+        isize m = n / 2;
+        isize p = 0;
+        if (n > KG_SORT_NINTHER_THRESHOLD) {
+            isize s = n / 8;
+            p = kg_quicksort_median3_(a,
+                kg_quicksort_median3_(a, 0, s, 2 * s, stride, compare_fn),
+                kg_quicksort_median3_(a, m - s, m, m + s, stride, compare_fn),
+                kg_quicksort_median3_(a, n - 1 - 2 * s, n - 1 - s, n - 1, stride, compare_fn),
+                stride, compare_fn);
+        } else {
+            p = kg_quicksort_median3_(a, 0, m, n - 1, stride, compare_fn);
+        }
+        if (p != 0) {
+            kg_mem_swap(a, a + p * stride, stride);
+        }
+        isize i = 0;
+        isize j = n;
+        for (;;) {
+            do { i++; } while (i < n && compare_fn(a + i * stride, a) < 0);
+            do { j--; } while (compare_fn(a, a + j * stride) < 0);
+            if (i >= j) {
+                break;
+            }
+            kg_mem_swap(a + i * stride, a + j * stride, stride);
+        }
+        if (j != 0) {
+            kg_mem_swap(a, a + j * stride, stride);
+        }
+        if (j < n - 1 - j) {
+            kg_quicksort_intro_(a, j, stride, compare_fn, depth);
+            a += (j + 1) * stride;
+            n -= j + 1;
+        } else {
+            kg_quicksort_intro_(a + (j + 1) * stride, n - 1 - j, stride, compare_fn, depth);
+            n = j;
+        }
+    }
+    kg_quicksort_insertion_(a, n, stride, compare_fn);
+}
 void kg_quicksort(void* src, isize start_inc, isize end_exc, isize stride, kg_compare_fn_t compare_fn) {
-    if (src == null || stride == 0 || compare_fn == null || start_inc >= end_exc) {
+    if (src == null || stride == 0 || compare_fn == null || end_exc - start_inc < 2) {
         return;
     }
-    u8* casted_src = kg_cast(u8*)src;
-    isize i = start_inc;
-    isize j = end_exc - 1;
-    u8* p = casted_src + ((start_inc + (end_exc - start_inc) / 2) * stride);
-    while(i <= j) {
-        while(compare_fn(casted_src + (i * stride), p) < 0) {i++;}
-        while(compare_fn(casted_src + (j * stride), p) > 0) {j--;}
-        if (i <= j) {
-            kg_mem_swap(casted_src + (i * stride), casted_src + (j * stride), stride);
-            i++;
-            j--;
-        }
+    isize n = end_exc - start_inc;
+    kg_quicksort_intro_(kg_cast(u8*)src + start_inc * stride, n, stride, compare_fn, 2 * (63 - __builtin_clzll(kg_cast(u64)n)));
+}
+
+typedef u32 __attribute__((may_alias)) kg_radix_u32_t;
+typedef u64 __attribute__((may_alias)) kg_radix_u64_t;
+
+#define KG_RADIX_SORT_CORE_(UT, W) \
+    kg_static b32 kg_radix_sort_core##W##_(UT* keys, isize* values, isize n, kg_allocator_t* scratch) { \
+        isize counts[W][256] = {0}; \
+        for (isize i = 0; i < n; i++) { \
+            UT k = keys[i]; \
+            for (isize d = 0; d < W; d++) { \
+                counts[d][(k >> (d * 8)) & 0xff]++; \
+            } \
+        } \
+        u32 digits = 0; \
+        for (isize d = 0; d < W; d++) { \
+            if (counts[d][(keys[0] >> (d * 8)) & 0xff] != n) { \
+                digits |= 1u << d; \
+            } \
+        } \
+        if (digits == 0) { \
+            return true; \
+        } \
+        UT* tmp_keys = kg_allocator_alloc_uninit(scratch, n * kg_sizeof(UT)); \
+        isize* tmp_values = values ? kg_allocator_alloc_uninit(scratch, n * kg_sizeof(isize)) : null; \
+        if (!tmp_keys || (values && !tmp_values)) { \
+            if (tmp_keys) { kg_allocator_free(scratch, tmp_keys, n * kg_sizeof(UT)); } \
+            if (tmp_values) { kg_allocator_free(scratch, tmp_values, n * kg_sizeof(isize)); } \
+            return false; \
+        } \
+        UT* src_keys = keys; \
+        UT* dst_keys = tmp_keys; \
+        isize* src_values = values; \
+        isize* dst_values = tmp_values; \
+        for (isize d = 0; d < W; d++) { \
+            isize shift = d * 8; \
+            if (!(digits & (1u << d))) { \
+                continue; \
+            } \
+            isize offsets[256]; \
+            isize sum = 0; \
+            for (isize b = 0; b < 256; b++) { \
+                offsets[b] = sum; \
+                sum += counts[d][b]; \
+            } \
+            for (isize i = 0; i < n; i++) { \
+                isize o = offsets[(src_keys[i] >> shift) & 0xff]++; \
+                dst_keys[o] = src_keys[i]; \
+                if (values) { \
+                    dst_values[o] = src_values[i]; \
+                } \
+            } \
+            UT* t = src_keys; src_keys = dst_keys; dst_keys = t; \
+            isize* tv = src_values; src_values = dst_values; dst_values = tv; \
+        } \
+        if (src_keys != keys) { \
+            kg_mem_copy(keys, src_keys, n * kg_sizeof(UT)); \
+            if (values) { \
+                kg_mem_copy(values, src_values, n * kg_sizeof(isize)); \
+            } \
+        } \
+        kg_allocator_free(scratch, tmp_keys, n * kg_sizeof(UT)); \
+        if (tmp_values) { \
+            kg_allocator_free(scratch, tmp_values, n * kg_sizeof(isize)); \
+        } \
+        return true; \
+    }
+
+KG_RADIX_SORT_CORE_(kg_radix_u32_t, 4)
+KG_RADIX_SORT_CORE_(kg_radix_u64_t, 8)
+
+kg_static kg_inline u32 kg_radix_f32_to_bits_(u32 b) {
+    return b & 0x80000000u ? ~b : b ^ 0x80000000u;
+}
+kg_static kg_inline u32 kg_radix_f32_from_bits_(u32 b) {
+    return b & 0x80000000u ? b ^ 0x80000000u : ~b;
+}
+kg_static kg_inline u64 kg_radix_f64_to_bits_(u64 b) {
+    return b & 0x8000000000000000ull ? ~b : b ^ 0x8000000000000000ull;
+}
+kg_static kg_inline u64 kg_radix_f64_from_bits_(u64 b) {
+    return b & 0x8000000000000000ull ? b ^ 0x8000000000000000ull : ~b;
+}
+
+b32 kg_radix_sort_u32(u32* keys, isize* values, isize n, kg_allocator_t* scratch) {
+    return n < 2 || kg_radix_sort_core4_(kg_cast(kg_radix_u32_t*)keys, values, n, scratch);
+}
+b32 kg_radix_sort_i32(i32* keys, isize* values, isize n, kg_allocator_t* scratch) {
+    b32 out_ok = true;
+    if (n >= 2) {
+        kg_radix_u32_t* bits = kg_cast(kg_radix_u32_t*)keys;
+        for (isize i = 0; i < n; i++) { bits[i] ^= 0x80000000u; }
+        out_ok = kg_radix_sort_core4_(bits, values, n, scratch);
+        for (isize i = 0; i < n; i++) { bits[i] ^= 0x80000000u; }
     }
-    if (start_inc < j) {
-        kg_quicksort(src, start_inc, j + 1, stride, compare_fn);
+    return out_ok;
+}
+b32 kg_radix_sort_f32(f32* keys, isize* values, isize n, kg_allocator_t* scratch) {
+    b32 out_ok = true;
+    if (n >= 2) {
+        kg_radix_u32_t* bits = kg_cast(kg_radix_u32_t*)keys;
+        for (isize i = 0; i < n; i++) { bits[i] = kg_radix_f32_to_bits_(bits[i]); }
+        out_ok = kg_radix_sort_core4_(bits, values, n, scratch);
+        for (isize i = 0; i < n; i++) { bits[i] = kg_radix_f32_from_bits_(bits[i]); }
+    }
+    return out_ok;
+}
+b32 kg_radix_sort_u64(u64* keys, isize* values, isize n, kg_allocator_t* scratch) {
+    return n < 2 || kg_radix_sort_core8_(kg_cast(kg_radix_u64_t*)keys, values, n, scratch);
+}
+b32 kg_radix_sort_i64(i64* keys, isize* values, isize n, kg_allocator_t* scratch) {
+    b32 out_ok = true;
+    if (n >= 2) {
+        kg_radix_u64_t* bits = kg_cast(kg_radix_u64_t*)keys;
+        for (isize i = 0; i < n; i++) { bits[i] ^= 0x8000000000000000ull; }
+        out_ok = kg_radix_sort_core8_(bits, values, n, scratch);
+        for (isize i = 0; i < n; i++) { bits[i] ^= 0x8000000000000000ull; }
     }
-    if (i < end_exc) {
-        kg_quicksort(src, i - 1, end_exc, stride, compare_fn);
+    return out_ok;
+}
+b32 kg_radix_sort_f64(f64* keys, isize* values, isize n, kg_allocator_t* scratch) {
+    b32 out_ok = true;
+    if (n >= 2) {
+        kg_radix_u64_t* bits = kg_cast(kg_radix_u64_t*)keys;
+        for (isize i = 0; i < n; i++) { bits[i] = kg_radix_f64_to_bits_(bits[i]); }
+        out_ok = kg_radix_sort_core8_(bits, values, n, scratch);
+        for (isize i = 0; i < n; i++) { bits[i] = kg_radix_f64_from_bits_(bits[i]); }
     }
+    return out_ok;
 }
 
 kg_inline i32 kg_cstr_compare(const void* a, const void* b) {
@@ -902,25 +3457,28 @@ kg_inline i32 kg_cstr_compare_ci_n(const void* a, const void* b, isize n) {
     return out;
 }
 kg_inline isize kg_cstr_len(const char* c) {
-    return kg_cast(isize)strnlen(c, ISIZE_MAX);
+    return kg_cast(isize)strlen(c);
 }
 kg_inline isize kg_cstr_len_n(const char* c, isize n) {
     return kg_cast(isize)strnlen(c, n);
 }
 
-kg_string_t kg_string_create(kg_allocator_t* a, isize cap) {
+kg_string_t (kg_string_create)(kg_allocator_t* a, isize cap) {
     kg_string_t out_string = null;
     isize mem_size = kg_sizeof(kg_string_header_t) + cap + 1;
-    kg_string_header_t* h = kg_cast(kg_string_header_t*)a->proc.alloc(a, mem_size);
+    kg_string_header_t* h = kg_cast(kg_string_header_t*)kg_allocator_alloc_uninit(a, mem_size);
     if (h) {
-        kg_mem_zero(h, mem_size);
-        h->allocator = a;
-        h->cap = cap;
+        *h = (kg_string_header_t){
+            .len       = 0,
+            .cap       = cap,
+            .allocator = a,
+        };
         out_string = kg_cast(kg_string_t)(h + 1);
+        out_string[0] = '\0';
     }
     return out_string;
 }
-kg_string_t kg_string_from_unsafe(kg_allocator_t* a, const void* v, isize v_len) {
+kg_string_t (kg_string_from_unsafe)(kg_allocator_t* a, const void* v, isize v_len) {
     kg_string_t out_string = kg_string_create(a, v_len);
     if (out_string) {
         kg_mem_copy(out_string, v, v_len);
@@ -930,7 +3488,7 @@ kg_string_t kg_string_from_unsafe(kg_allocator_t* a, const void* v, isize v_len)
     }
     return out_string;
 }
-kg_string_t kg_string_from_fmt(kg_allocator_t* a, const char* fmt, ...) {
+kg_string_t (kg_string_from_fmt)(kg_allocator_t* a, const char* fmt, ...) {
     kg_string_t out_string = null;
     if (fmt) {
         va_list args;
@@ -940,7 +3498,7 @@ kg_string_t kg_string_from_fmt(kg_allocator_t* a, const char* fmt, ...) {
     }
     return out_string;
 }
-kg_string_t kg_string_from_fmt_v(kg_allocator_t* a, const char* fmt, va_list args) {
+kg_string_t (kg_string_from_fmt_v)(kg_allocator_t* a, const char* fmt, va_list args) {
     kg_string_t out_string = null;
     if (fmt) {
         va_list args_copy;
@@ -960,32 +3518,33 @@ kg_string_t kg_string_from_fmt_v(kg_allocator_t* a, const char* fmt, va_list arg
     }
     return out_string;
 }
-kg_inline kg_string_t kg_string_from_str(kg_allocator_t* a, const kg_str_t s) {
+kg_inline kg_string_t (kg_string_from_str)(kg_allocator_t* a, const kg_str_t s) {
     return kg_string_from_cstr_n(a, s.ptr, s.len);
 }
-kg_inline kg_string_t kg_string_from_str_n(kg_allocator_t* a, const kg_str_t s, isize n) {
+kg_inline kg_string_t (kg_string_from_str_n)(kg_allocator_t* a, const kg_str_t s, isize n) {
     return kg_string_from_cstr_n(a, s.ptr, n > s.len ? s.len : n);
 }
-kg_inline kg_string_t kg_string_from_cstr(kg_allocator_t* a, const char* cstr) {
+kg_inline kg_string_t (kg_string_from_cstr)(kg_allocator_t* a, const char* cstr) {
     return kg_string_from_cstr_n(a, cstr, kg_cstr_len(cstr));
 }
-kg_string_t kg_string_from_cstr_n(kg_allocator_t* a, const char* cstr, isize cstr_len) {
+kg_string_t (kg_string_from_cstr_n)(kg_allocator_t* a, const char* cstr, isize cstr_len) {
     kg_string_t out_string = null;
     isize cap = cstr_len;
     isize mem_size = kg_sizeof(kg_string_header_t) + cap + 1;
-    kg_string_header_t* h = kg_cast(kg_string_header_t*)a->proc.alloc(a, mem_size);
+    kg_string_header_t* h = kg_cast(kg_string_header_t*)kg_allocator_alloc_uninit(a, mem_size);
     if (h) {
-        kg_mem_zero(h, mem_size);
-        h->allocator = a;
-        h->cap = cap;
-        h->len = cstr_len;
+        *h = (kg_string_header_t){
+            .len       = cstr_len,
+            .cap       = cap,
+            .allocator = a,
+        };
         out_string = kg_cast(kg_string_t)(h + 1);
         kg_mem_copy(out_string, cstr, cstr_len);
         out_string[h->len] = '\0';
     }
     return out_string;
 }
-kg_string_t kg_string_set(kg_string_t s, const char* cstr) {
+kg_string_t (kg_string_set)(kg_string_t s, const char* cstr) {
     kg_string_t out = s;
     isize cstr_len = kg_cstr_len(cstr);
     if (cstr_len >= 0) {
@@ -999,7 +3558,7 @@ kg_string_t kg_string_set(kg_string_t s, const char* cstr) {
     }
     return out;
 }
-kg_string_t kg_string_append(kg_string_t s, kg_string_t other) {
+kg_string_t (kg_string_append)(kg_string_t s, kg_string_t other) {
     kg_string_t out_string = s;
     kg_string_header_t* s_h = kg_string_header(s);
     kg_string_header_t* other_h = kg_string_header(other);
@@ -1011,7 +3570,7 @@ kg_string_t kg_string_append(kg_string_t s, kg_string_t other) {
     }
     return out_string;
 }
-kg_string_t kg_string_append_unsafe(kg_string_t s, const void* v, isize v_len) {
+kg_string_t (kg_string_append_unsafe)(kg_string_t s, const void* v, isize v_len) {
     kg_string_t out_string = null;
     kg_string_header_t* s_h = kg_string_header(s);
     out_string = kg_string_ensure_available(s, v_len);
@@ -1022,7 +3581,7 @@ kg_string_t kg_string_append_unsafe(kg_string_t s, const void* v, isize v_len) {
     }
     return out_string;
 }
-kg_string_t kg_string_append_fmt(kg_string_t s, const char* fmt, ...) {
+kg_string_t (kg_string_append_fmt)(kg_string_t s, const char* fmt, ...) {
     kg_string_t out_string = s;
     if (fmt) {
         va_list args;
@@ -1032,7 +3591,7 @@ kg_string_t kg_string_append_fmt(kg_string_t s, const char* fmt, ...) {
     }
     return out_string;
 }
-kg_string_t kg_string_append_fmt_v(kg_string_t s, const char* fmt, va_list args) {
+kg_string_t (kg_string_append_fmt_v)(kg_string_t s, const char* fmt, va_list args) {
     kg_string_t out_string = s;
     if (fmt) {
         va_list args_copy;
@@ -1053,20 +3612,20 @@ kg_string_t kg_string_append_fmt_v(kg_string_t s, const char* fmt, va_list args)
     }
     return out_string;
 }
-kg_inline kg_string_t kg_string_append_char(kg_string_t s, char c) {
+kg_inline kg_string_t (kg_string_append_char)(kg_string_t s, char c) {
     return kg_string_append_unsafe(s, &c, 1);
 }
-kg_inline kg_string_t kg_string_append_rune(kg_string_t s, rune r) {
+kg_inline kg_string_t (kg_string_append_rune)(kg_string_t s, rune r) {
     kg_string_t out = s;
     u8 buf[8] = {0};
     isize len = kg_utf8_encode_rune(buf, r);
     out = kg_string_append_unsafe(s, buf, len);
     return out;
 }
-kg_string_t kg_string_append_cstr(kg_string_t s, const char* cstr) {
+kg_string_t (kg_string_append_cstr)(kg_string_t s, const char* cstr) {
     return kg_string_append_cstr_n(s, cstr, kg_cstr_len(cstr));
 }
-kg_string_t kg_string_append_cstr_n(kg_string_t s, const char* cstr, isize cstr_len) {
+kg_string_t (kg_string_append_cstr_n)(kg_string_t s, const char* cstr, isize cstr_len) {
     kg_string_t out_string = null;
     if (cstr && cstr_len > 0) {
         out_string = kg_string_ensure_available(s, cstr_len);
@@ -1079,12 +3638,12 @@ kg_string_t kg_string_append_cstr_n(kg_string_t s, const char* cstr, isize cstr_
     }
     return out_string;
 }
-kg_string_t kg_string_grow(kg_string_t s, isize n) {
+kg_string_t (kg_string_grow)(kg_string_t s, isize n) {
     kg_string_t out_string = null;
     kg_string_header_t* h = kg_string_header(s);
     isize old_mem_size = kg_string_mem_size(s);
-    isize new_mem_size = old_mem_size + n + 1;
-    kg_string_header_t* new_h = kg_cast(kg_string_header_t*)h->allocator->proc.resize(h->allocator, h, old_mem_size, new_mem_size);
+    isize new_mem_size = old_mem_size + n;
+    kg_string_header_t* new_h = kg_cast(kg_string_header_t*)kg_allocator_resize(h->allocator, h, old_mem_size, new_mem_size);
     if (new_h) {
         new_h->cap += n;
         out_string = kg_cast(kg_string_t)(new_h + 1);
@@ -1117,7 +3676,7 @@ kg_inline isize kg_string_available(const kg_string_t s) {
     }
     return out_available;
 }
-kg_inline kg_string_t kg_string_ensure_available(kg_string_t s, isize n) {
+kg_inline kg_string_t (kg_string_ensure_available)(kg_string_t s, isize n) {
     kg_string_t out_string = null;
     if (s) {
         isize available = kg_string_available(s);
@@ -1209,7 +3768,7 @@ void kg_string_destroy(kg_string_t s) {
     if (s) {
         kg_string_header_t* h = kg_string_header(s);
         isize mem_size = kg_string_mem_size(s);
-        h->allocator->proc.free(h->allocator, h, mem_size);
+        kg_allocator_free(h->allocator, h, mem_size);
     }
 }
 
@@ -1352,6 +3911,9 @@ kg_inline b32 kg_str_is_valid_cstr(const kg_str_t s) {
 kg_inline b32 kg_str_is_equal(const kg_str_t s, const kg_str_t other) {
     return kg_str_compare(&s, &other) == 0;
 }
+kg_inline u64 kg_str_hash(const kg_str_t s) {
+    return kg_hash_bytes(s.ptr, s.len);
+}
 kg_inline b32 kg_str_contains(const kg_str_t s, const kg_str_t needle) {
     return kg_str_index(s, needle) >= 0;
 }
@@ -1756,7 +4318,7 @@ b32 kg_string_builder_create(kg_string_builder_t* b, kg_allocator_t* a, isize ca
     *b = (kg_string_builder_t){
         .allocator = a,
         .cap       = cap,
-        .real_ptr  = kg_allocator_alloc(a, cap),
+        .real_ptr  = kg_allocator_alloc_uninit(a, cap),
     };
     if (b->real_ptr) {
         b->write_ptr = b->real_ptr;
@@ -1919,8 +4481,8 @@ void kg_string_builder_destroy(kg_string_builder_t* b) {
     }
 }
 
-void* kg_darray_create2_(kg_allocator_t* a, isize stride, isize cap, kg_darray_base_t* out_b) {
-    void* out_ptr = kg_allocator_alloc(a, cap * stride);
+void* (kg_darray_create2_)(kg_allocator_t* a, isize stride, isize cap, kg_darray_base_t* out_b) {
+    void* out_ptr = kg_allocator_alloc_uninit(a, cap * stride);
     if (out_ptr) {
         out_b->allocator = a;
         out_b->stride    = stride;
@@ -1929,7 +4491,7 @@ void* kg_darray_create2_(kg_allocator_t* a, isize stride, isize cap, kg_darray_b
     }
     return out_ptr;
 }
-void* kg_darray_grow2_(kg_darray_base_t* b, isize n, void** out_ptr) {
+void* (kg_darray_grow2_)(kg_darray_base_t* b, isize n, void** out_ptr) {
     void* out_new_ptr = null;
     isize old_mem_size = b->cap * b->stride;
     isize new_mem_size = old_mem_size + n * b->stride;
@@ -1940,51 +4502,407 @@ void* kg_darray_grow2_(kg_darray_base_t* b, isize n, void** out_ptr) {
     }
     return out_new_ptr;
 }
-void* kg_darray_grow_formula2_(kg_darray_base_t* b, isize n, void** out_ptr) {
+void* (kg_darray_grow_formula2_)(kg_darray_base_t* b, isize n, void** out_ptr) {
     return kg_darray_grow2_(b, b->cap + n, out_ptr);
 }
-void* kg_darray_ensure_available2_(kg_darray_base_t* b, isize n, void** out_ptr) {
+void* (kg_darray_ensure_available2_)(kg_darray_base_t* b, isize n, void** out_ptr) {
     if (b->len + n > b->cap) {
         if (!kg_darray_grow_formula2_(b, n, out_ptr)) {
             return null;
         }
     }
-    return *out_ptr;
+    return *out_ptr;
+}
+
+b32 kg_chunk_builder_create(kg_chunk_builder_t* b, kg_allocator_t* a, isize chunk_size) {
+    b32 out_ok = false;
+    if (b && a) {
+        *b = (kg_chunk_builder_t){
+            .allocator  = a,
+            .chunks     = kg_darray_string_create(a, 8),
+            .chunk_size = chunk_size > 0 ? chunk_size : KG_CHUNK_BUILDER_DEFAULT_CHUNK_SIZE,
+            .len        = 0,
+        };
+        out_ok = b->chunks.ptr != null;
+    }
+    return out_ok;
+}
+kg_static kg_string_t kg_chunk_builder_last_(const kg_chunk_builder_t* b) {
+    isize chunks_len = kg_darray_string_len(&b->chunks);
+    return chunks_len > 0 ? b->chunks.ptr[chunks_len - 1] : null;
+}
+kg_static kg_string_t kg_chunk_builder_push_chunk_(kg_chunk_builder_t* b, isize cap) {
+    kg_string_t out_chunk = kg_string_create(b->allocator, kg_max(cap, b->chunk_size));
+    if (out_chunk && !kg_darray_string_append(&b->chunks, out_chunk)) {
+        kg_string_destroy(out_chunk);
+        out_chunk = null;
+    }
+    return out_chunk;
+}
+b32 kg_chunk_builder_write(kg_chunk_builder_t* b, const void* v, isize n) {
+    b32 out_ok = n >= 0;
+    const u8* bytes = kg_cast(const u8*)v;
+    kg_string_t chunk = kg_chunk_builder_last_(b);
+    while (out_ok && n > 0) {
+        isize available = chunk ? kg_string_available(chunk) : 0;
+        if (available == 0) {
+            chunk = kg_chunk_builder_push_chunk_(b, 0);
+            out_ok = chunk != null;
+            continue;
+        }
+        isize span = kg_min(available, n);
+        kg_string_header_t* h = kg_string_header(chunk);
+        kg_mem_copy(chunk + h->len, bytes, span);
+        h->len += span;
+        chunk[h->len] = '\0';
+        b->len += span;
+        bytes += span;
+        n -= span;
+    }
+    return out_ok;
+}
+kg_inline b32 kg_chunk_builder_write_cstr(kg_chunk_builder_t* b, const char* c) {
+    return kg_chunk_builder_write(b, c, kg_cstr_len(c));
+}
+kg_inline b32 kg_chunk_builder_write_str(kg_chunk_builder_t* b, const kg_str_t s) {
+    return kg_chunk_builder_write(b, s.ptr, s.len);
+}
+b32 kg_chunk_builder_write_fmt(kg_chunk_builder_t* b, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    b32 out_ok = kg_chunk_builder_write_fmt_v(b, fmt, args);
+    va_end(args);
+    return out_ok;
+}
+// Formatted output is not split, it goes into a fresh chunk when the tail of the last one is too short.
+b32 kg_chunk_builder_write_fmt_v(kg_chunk_builder_t* b, const char* fmt, va_list args) {
+    b32 out_ok = false;
+    if (fmt) {
+        va_list args_copy;
+        va_copy(args_copy, args);
+        isize length_check = vsnprintf(0, 0, fmt, args_copy);
+        va_end(args_copy);
+        if (length_check >= 0) {
+            isize length = kg_cast(isize)length_check;
+            kg_string_t chunk = kg_chunk_builder_last_(b);
+            if (!chunk || kg_string_available(chunk) < length) {
+                chunk = kg_chunk_builder_push_chunk_(b, length);
+            }
+            if (chunk) {
+                kg_string_header_t* h = kg_string_header(chunk);
+                vsnprintf(chunk + h->len, length + 1, fmt, args);
+                h->len += length;
+                b->len += length;
+                out_ok = true;
+            }
+        }
+    }
+    return out_ok;
+}
+isize kg_chunk_builder_write_fd(kg_chunk_builder_t* b, i32 fd) {
+    isize out_written = 0;
+    isize chunks_len = kg_darray_string_len(&b->chunks);
+    isize chunk_i = 0;
+    isize chunk_offset = 0;
+    while (chunk_i < chunks_len) {
+        struct iovec iov[KG_CHUNK_BUILDER_IOV_LEN];
+        i32 iov_len = 0;
+        for (isize i = chunk_i; i < chunks_len && iov_len < KG_CHUNK_BUILDER_IOV_LEN; i++) {
+            isize offset = i == chunk_i ? chunk_offset : 0;
+            iov[iov_len].iov_base = b->chunks.ptr[i] + offset;
+            iov[iov_len].iov_len  = kg_string_len(b->chunks.ptr[i]) - offset;
+            iov_len++;
+        }
+        isize written = writev(fd, iov, iov_len);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        out_written += written;
+        written += chunk_offset;
+        while (chunk_i < chunks_len && written >= kg_string_len(b->chunks.ptr[chunk_i])) {
+            written -= kg_string_len(b->chunks.ptr[chunk_i]);
+            chunk_i++;
+        }
+        chunk_offset = written;
+    }
+    return out_written;
+}
+kg_string_t kg_chunk_builder_to_string(const kg_chunk_builder_t* b, kg_allocator_t* a) {
+    kg_string_t out_string = kg_string_create(a, b->len);
+    if (out_string) {
+        char* dst = out_string;
+        for (isize i = 0; i < kg_darray_string_len(&b->chunks); i++) {
+            isize chunk_len = kg_string_len(b->chunks.ptr[i]);
+            kg_mem_copy(dst, b->chunks.ptr[i], chunk_len);
+            dst += chunk_len;
+        }
+        *dst = '\0';
+        kg_string_header(out_string)->len = b->len;
+    }
+    return out_string;
+}
+// Hands the only chunk over without copying, more chunks are joined into a new string.
+// The builder is empty afterwards either way.
+kg_string_t kg_chunk_builder_detach(kg_chunk_builder_t* b) {
+    kg_string_t out_string = null;
+    if (kg_darray_string_len(&b->chunks) == 1) {
+        out_string = b->chunks.ptr[0];
+        kg_darray_string_clear(&b->chunks);
+        b->len = 0;
+    } else {
+        out_string = kg_chunk_builder_to_string(b, b->allocator);
+        if (out_string) {
+            kg_chunk_builder_reset(b);
+        }
+    }
+    return out_string;
+}
+kg_inline isize kg_chunk_builder_len(const kg_chunk_builder_t* b) {
+    return b ? b->len : 0;
+}
+kg_inline isize kg_chunk_builder_chunks_len(const kg_chunk_builder_t* b) {
+    return b ? kg_darray_string_len(&b->chunks) : 0;
+}
+isize kg_chunk_builder_mem_size(const kg_chunk_builder_t* b) {
+    isize out = 0;
+    if (b) {
+        out = kg_darray_string_mem_size(&b->chunks);
+        for (isize i = 0; i < kg_darray_string_len(&b->chunks); i++) {
+            out += kg_string_mem_size(b->chunks.ptr[i]);
+        }
+    }
+    return out;
+}
+void kg_chunk_builder_reset(kg_chunk_builder_t* b) {
+    for (isize i = 0; i < kg_darray_string_len(&b->chunks); i++) {
+        kg_string_destroy(b->chunks.ptr[i]);
+    }
+    kg_darray_string_clear(&b->chunks);
+    b->len = 0;
+}
+void kg_chunk_builder_destroy(kg_chunk_builder_t* b) {
+    if (b) {
+        kg_chunk_builder_reset(b);
+        kg_darray_string_destroy(&b->chunks);
+        kg_mem_zero(b, kg_sizeof(kg_chunk_builder_t));
+    }
+}
+
+void* kg_small_darray_grow2_(kg_darray_base_t* b, isize n, const void* small, void** out_ptr) {
+    void* out_new_ptr = null;
+    if (*out_ptr) {
+        out_new_ptr = kg_darray_grow2_(b, n, out_ptr);
+    } else if (n > 0) {
+        out_new_ptr = kg_allocator_alloc_uninit(b->allocator, (b->cap + n) * b->stride);
+        if (out_new_ptr) {
+            kg_mem_copy(out_new_ptr, small, b->len * b->stride);
+            *out_ptr = out_new_ptr;
+            b->cap += n;
+        }
+    }
+    return out_new_ptr;
+}
+void* kg_small_darray_ensure_available2_(kg_darray_base_t* b, isize n, const void* small, void** out_ptr) {
+    if (b->len + n > b->cap) {
+        if (!kg_small_darray_grow2_(b, b->cap + n, small, out_ptr)) {
+            return null;
+        }
+        return *out_ptr;
+    }
+    return *out_ptr ? *out_ptr : kg_cast(void*)small;
+}
+
+void* (kg_darray_create_)(kg_allocator_t* allocator, isize stride, isize cap) {
+    void* out_darray = null;
+    isize mem_size = kg_sizeof(kg_darray_header_t) + cap * stride;
+    kg_darray_header_t* h = kg_cast(kg_darray_header_t*)kg_allocator_alloc_uninit(allocator, mem_size);
+    if (h) {
+        h->len = 0;
+        h->cap = cap;
+        h->stride = stride;
+        h->allocator = allocator;
+        out_darray = kg_cast(void*)(h + 1);
+    }
+    return out_darray;
+}
+void* (kg_darray_grow_)(void* d, isize n) {
+    kg_darray_header_t* old_h = kg_darray_header(d);
+    isize old_mem_size = kg_darray_mem_size(d);
+    isize new_mem_size = old_mem_size + old_h->stride * n;
+    kg_darray_header_t* new_h = kg_allocator_resize(old_h->allocator, old_h, old_mem_size, new_mem_size);
+    if (new_h) {
+        new_h->cap += n;
+        return kg_cast(void*)(new_h + 1);
+    }
+    return null;
+}
+
+kg_inline u64 kg_hash_u64(u64 u) {
+    u ^= u >> 33;
+    u *= 0xff51afd7ed558ccdull;
+    u ^= u >> 33;
+    u *= 0xc4ceb9fe1a85ec53ull;
+    u ^= u >> 33;
+    return u;
+}
+u64 kg_hash_bytes(const void* ptr, isize size) {
+    const u8* bytes = kg_cast(const u8*)ptr;
+    u64 out = kg_cast(u64)size * 0x9e3779b97f4a7c15ull;
+    isize i = 0;
+    for (; i + 8 <= size; i += 8) {
+        u64 word;
+        kg_mem_copy(&word, bytes + i, 8);
+        out = (out ^ word) * 0xbf58476d1ce4e5b9ull;
+        out ^= out >> 31;
+    }
+    if (i < size) {
+        u64 word = 0;
+        kg_mem_copy(&word, bytes + i, size - i);
+        out = (out ^ word) * 0xbf58476d1ce4e5b9ull;
+        out ^= out >> 31;
+    }
+    return kg_hash_u64(out);
+}
+
+kg_inline isize kg_map_table_mem_size_(isize stride, isize cap) {
+    return kg_align_up(stride * cap, KG_DEFAULT_ALIGNMENT) + cap + KG_MAP_GROUP_LEN;
+}
+// The table is kept at most 7/8 full, counting deleted slots.
+kg_inline isize kg_map_cap_for_(isize len) {
+    isize out = KG_MAP_MIN_CAP;
+    while (out - out / 8 < len) {
+        out *= 2;
+    }
+    return out;
+}
+void* kg_map_table_create_(kg_map_base_t* b, kg_allocator_t* a, isize stride, isize cap) {
+    void* out_entries = null;
+    if (b && a && stride > 0 && cap >= KG_MAP_MIN_CAP && kg_is_power_of_two(cap)) {
+        out_entries = kg_allocator_alloc_uninit(a, kg_map_table_mem_size_(stride, cap));
+        if (out_entries) {
+            *b = (kg_map_base_t){
+                .allocator = a,
+                .ctrl      = kg_cast(i8*)out_entries + kg_align_up(stride * cap, KG_DEFAULT_ALIGNMENT),
+                .cap       = cap,
+                .stride    = stride,
+            };
+            kg_map_table_clear_(b);
+        }
+    }
+    return out_entries;
+}
+void kg_map_table_destroy_(kg_map_base_t* b, void* entries) {
+    if (entries) {
+        kg_allocator_free(b->allocator, entries, kg_map_table_mem_size_(b->stride, b->cap));
+    }
+}
+void kg_map_table_clear_(kg_map_base_t* b) {
+    kg_mem_set(b->ctrl, kg_cast(u8)KG_MAP_CTRL_EMPTY, b->cap + KG_MAP_GROUP_LEN);
+    b->len = 0;
+    b->growth_left = b->cap - b->cap / 8;
+}
+
+b32 kg_interner_create(kg_interner_t* i, kg_allocator_t* a, isize block_size) {
+    b32 out_ok = false;
+    *i = (kg_interner_t){0};
+    if (kg_arena_create_chained(&i->arena, a, block_size)) {
+        if (kg_map_interner_create(&i->ids, a, 0)) {
+            i->strs = kg_darray_str_create(a, KG_MAP_MIN_CAP);
+            if (i->strs.ptr) {
+                out_ok = true;
+            } else {
+                kg_map_interner_destroy(&i->ids);
+                kg_arena_destroy(&i->arena);
+            }
+        } else {
+            kg_arena_destroy(&i->arena);
+        }
+    }
+    return out_ok;
+}
+u32 kg_interner_intern(kg_interner_t* i, const kg_str_t s) {
+    u32 out_id = KG_INTERNER_ID_INVALID;
+    b32 inserted = false;
+    kg_map_interner_entry_t* entry = kg_map_interner_get_or_insert_entry(&i->ids, s, &inserted);
+    if (entry && !inserted) {
+        out_id = entry->value;
+    } else if (entry) {
+        char* bytes = kg_arena_alloc_align(&i->arena, s.len + 1, 1);
+        isize len = kg_darray_str_len(&i->strs);
+        if (bytes && len < KG_INTERNER_ID_INVALID) {
+            kg_mem_copy(bytes, s.ptr, s.len);
+            bytes[s.len] = '\0';
+            kg_str_t interned = kg_str_create_n(bytes, s.len);
+            if (kg_darray_str_append(&i->strs, interned)) {
+                // the key still points at the caller's bytes, swap in the interned copy
+                entry->key = interned;
+                entry->value = kg_cast(u32)len;
+                out_id = entry->value;
+            }
+        }
+        if (out_id == KG_INTERNER_ID_INVALID) {
+            kg_map_interner_remove(&i->ids, s);
+        }
+    }
+    return out_id;
 }
-
-void* kg_darray_create_(kg_allocator_t* allocator, isize stride, isize cap) {
-    void* out_darray = null;
-    isize mem_size = kg_sizeof(kg_darray_header_t) + cap * stride;
-    kg_darray_header_t* h = kg_cast(kg_darray_header_t*)kg_allocator_alloc(allocator, mem_size);
-    if (h) {
-        h->len = 0;
-        h->cap = cap;
-        h->stride = stride;
-        h->allocator = allocator;
-        out_darray = kg_cast(void*)(h + 1);
+kg_str_t kg_interner_intern_str(kg_interner_t* i, const kg_str_t s) {
+    return kg_interner_str(i, kg_interner_intern(i, s));
+}
+u32 kg_interner_find(const kg_interner_t* i, const kg_str_t s) {
+    u32* id = kg_map_interner_get(&i->ids, s);
+    return id ? *id : KG_INTERNER_ID_INVALID;
+}
+kg_str_t kg_interner_str(const kg_interner_t* i, u32 id) {
+    return kg_cast(isize)id < kg_darray_str_len(&i->strs) ? i->strs.ptr[id] : kg_str_create_null();
+}
+kg_inline isize kg_interner_len(const kg_interner_t* i) {
+    return i ? kg_darray_str_len(&i->strs) : 0;
+}
+isize kg_interner_mem_size(const kg_interner_t* i) {
+    isize out = 0;
+    if (i) {
+        out = kg_arena_mem_size(&i->arena) + kg_map_interner_mem_size(&i->ids) + kg_darray_str_mem_size(&i->strs);
     }
-    return out_darray;
+    return out;
 }
-void* kg_darray_grow_(void* d, isize n) {
-    kg_darray_header_t* old_h = kg_darray_header(d);
-    isize old_mem_size = kg_darray_mem_size(d);
-    isize new_mem_size = old_mem_size + old_h->stride * n;
-    kg_darray_header_t* new_h = kg_allocator_resize(old_h->allocator, old_h, old_mem_size, new_mem_size);
-    if (new_h) {
-        new_h->cap += n;
-        return kg_cast(void*)(new_h + 1);
+void kg_interner_destroy(kg_interner_t* i) {
+    if (i) {
+        kg_darray_str_destroy(&i->strs);
+        kg_map_interner_destroy(&i->ids);
+        kg_arena_destroy(&i->arena);
+        kg_mem_zero(i, kg_sizeof(kg_interner_t));
     }
-    return null;
 }
 
+// Grows the buffer by n, a head segment that wrapped around is moved to the end.
+kg_static void* kg_queue_ring_grow_(kg_allocator_t* a, void* ptr, isize stride, isize* head, isize len, isize* cap, isize n) {
+    void* out_ptr = null;
+    if (n > 0) {
+        out_ptr = kg_allocator_resize(a, ptr, *cap * stride, (*cap + n) * stride);
+        if (out_ptr) {
+            if (*head + len > *cap) {
+                u8* bytes = kg_cast(u8*)out_ptr;
+                kg_mem_move(bytes + (*head + n) * stride, bytes + *head * stride, (*cap - *head) * stride);
+                *head += n;
+            }
+            *cap += n;
+        }
+    }
+    return out_ptr;
+}
 b32 kg_queue_create(kg_queue_t* q, kg_allocator_t* allocator, isize stride, isize cap) {
     b32 out_ok = false;
     *q = (kg_queue_t){
         .allocator = allocator, 
+        .head      = 0,
         .len       = 0,
         .cap       = cap,
         .stride    = stride,
-        .real_ptr  = kg_allocator_alloc(allocator, stride * cap),
+        .real_ptr  = kg_allocator_alloc_uninit(allocator, stride * cap),
     };
     if (q->real_ptr) {
         out_ok = true;
@@ -1994,7 +4912,7 @@ b32 kg_queue_create(kg_queue_t* q, kg_allocator_t* allocator, isize stride, isiz
 b32 kg_queue_peek(const kg_queue_t* q, void* o) {
     b32 out_ok = false;
     if (q->len > 0) {
-        kg_mem_copy(o, q->real_ptr, q->stride);
+        kg_mem_copy(o, kg_cast(u8*)q->real_ptr + q->head * q->stride, q->stride);
         out_ok = true;
     }
     return out_ok;
@@ -2002,42 +4920,40 @@ b32 kg_queue_peek(const kg_queue_t* q, void* o) {
 b32 kg_queue_enqueue(kg_queue_t* q, const void* o) {
     b32 out_ok = false;
     if (o && kg_queue_ensure_available(q, 1)) {
-        if (kg_mem_copy(kg_cast(u8*)q->real_ptr + (q->len * q->stride), o, q->stride) != null) {
-            q->len++;
-            out_ok = true;
+        isize tail = q->head + q->len;
+        if (tail >= q->cap) {
+            tail -= q->cap;
         }
+        kg_mem_copy(kg_cast(u8*)q->real_ptr + tail * q->stride, o, q->stride);
+        q->len++;
+        out_ok = true;
     }
     return out_ok;
 }
 b32 kg_queue_deque(kg_queue_t* q, void* o) {
     b32 out_ok = false;
     if (o && q->len > 0) {
-        out_ok = kg_mem_copy(o, q->real_ptr, q->stride) != null;
-        if (out_ok) {
-            kg_mem_move(q->real_ptr, kg_cast(u8*)q->real_ptr + q->stride, (q->len - 1) * q->stride);
-            q->len--;
-        } 
+        kg_mem_copy(o, kg_cast(u8*)q->real_ptr + q->head * q->stride, q->stride);
+        q->head++;
+        if (q->head == q->cap) {
+            q->head = 0;
+        }
+        q->len--;
+        out_ok = true;
     }
     return out_ok;
 }
 b32 kg_queue_grow(kg_queue_t* q, isize n) {
-    b32 out_ok = false;
-    if (n > 0) {
-        isize old_mem_size = kg_queue_mem_size(q);
-        isize new_mem_size = kg_queue_mem_size(q) + q->stride * n;
-        void* new_real_ptr = kg_allocator_resize(q->allocator, q->real_ptr, old_mem_size, new_mem_size);
-        if (new_real_ptr) {
-            q->cap += n;
-            q->real_ptr = new_real_ptr;
-            out_ok = true;
-        }
+    void* new_real_ptr = kg_queue_ring_grow_(q->allocator, q->real_ptr, q->stride, &q->head, q->len, &q->cap, n);
+    if (new_real_ptr) {
+        q->real_ptr = new_real_ptr;
     }
-    return out_ok;
+    return new_real_ptr != null;
 }
 kg_inline b32 kg_queue_ensure_available(kg_queue_t* q, isize n) {
     b32 out_ok = true;
     if (kg_queue_available(q) < n) {
-        out_ok = kg_queue_grow(q, n);
+        out_ok = kg_queue_grow(q, kg_max(n, q->cap));
     }
     return out_ok;
 }
@@ -2071,6 +4987,124 @@ void kg_queue_destroy(kg_queue_t* q) {
     }
 }
 
+void* kg_queue_create2_(kg_allocator_t* a, isize stride, isize cap, kg_queue_base_t* out_b) {
+    void* out_ptr = kg_allocator_alloc_uninit(a, cap * stride);
+    if (out_ptr) {
+        *out_b = (kg_queue_base_t){
+            .allocator = a,
+            .head      = 0,
+            .len       = 0,
+            .cap       = cap,
+            .stride    = stride,
+        };
+    }
+    return out_ptr;
+}
+void* kg_queue_grow2_(kg_queue_base_t* b, isize n, void** out_ptr) {
+    void* out_new_ptr = kg_queue_ring_grow_(b->allocator, *out_ptr, b->stride, &b->head, b->len, &b->cap, n);
+    if (out_new_ptr) {
+        *out_ptr = out_new_ptr;
+    }
+    return out_new_ptr;
+}
+void* kg_queue_ensure_available2_(kg_queue_base_t* b, isize n, void** out_ptr) {
+    if (b->len + n > b->cap) {
+        if (!kg_queue_grow2_(b, kg_max(n, b->cap), out_ptr)) {
+            return null;
+        }
+    }
+    return *out_ptr;
+}
+
+b32 kg_spsc_ring_create(kg_spsc_ring_t* r, kg_allocator_t* a, isize stride, isize cap) {
+    b32 out_ok = false;
+    if (r && a && stride > 0 && kg_is_power_of_two(cap)) {
+        *r = (kg_spsc_ring_t){
+            .allocator = a,
+            .mask      = cap - 1,
+            .stride    = stride,
+        };
+        r->ptr = kg_allocator_alloc_uninit(a, cap * stride);
+        out_ok = r->ptr != null;
+    }
+    return out_ok;
+}
+// Producer side, n is the requested count on input and the contiguous writable count on output.
+void* kg_spsc_ring_write_acquire(kg_spsc_ring_t* r, isize* n) {
+    isize cap = r->mask + 1;
+    isize available = cap - (r->write_pos - r->read_pos_cached);
+    if (available < *n) {
+        r->read_pos_cached = kg_atomic_load(&r->read_pos);
+        available = cap - (r->write_pos - r->read_pos_cached);
+    }
+    isize index = r->write_pos & r->mask;
+    *n = kg_min(*n, kg_min(available, cap - index));
+    return *n > 0 ? r->ptr + index * r->stride : null;
+}
+void kg_spsc_ring_write_commit(kg_spsc_ring_t* r, isize n) {
+    kg_atomic_store(&r->write_pos, r->write_pos + n);
+}
+// Consumer side, n is the requested count on input and the contiguous readable count on output.
+void* kg_spsc_ring_read_acquire(kg_spsc_ring_t* r, isize* n) {
+    isize cap = r->mask + 1;
+    isize len = r->write_pos_cached - r->read_pos;
+    if (len < *n) {
+        r->write_pos_cached = kg_atomic_load(&r->write_pos);
+        len = r->write_pos_cached - r->read_pos;
+    }
+    isize index = r->read_pos & r->mask;
+    *n = kg_min(*n, kg_min(len, cap - index));
+    return *n > 0 ? r->ptr + index * r->stride : null;
+}
+void kg_spsc_ring_read_commit(kg_spsc_ring_t* r, isize n) {
+    kg_atomic_store(&r->read_pos, r->read_pos + n);
+}
+isize kg_spsc_ring_push(kg_spsc_ring_t* r, const void* src, isize n) {
+    isize out_n = 0;
+    const u8* bytes = kg_cast(const u8*)src;
+    while (out_n < n) {
+        isize span = n - out_n;
+        void* dst = kg_spsc_ring_write_acquire(r, &span);
+        if (!dst) {
+            break;
+        }
+        kg_mem_copy(dst, bytes + out_n * r->stride, span * r->stride);
+        kg_spsc_ring_write_commit(r, span);
+        out_n += span;
+    }
+    return out_n;
+}
+isize kg_spsc_ring_pop(kg_spsc_ring_t* r, void* dst, isize n) {
+    isize out_n = 0;
+    u8* bytes = kg_cast(u8*)dst;
+    while (out_n < n) {
+        isize span = n - out_n;
+        void* src = kg_spsc_ring_read_acquire(r, &span);
+        if (!src) {
+            break;
+        }
+        kg_mem_copy(bytes + out_n * r->stride, src, span * r->stride);
+        kg_spsc_ring_read_commit(r, span);
+        out_n += span;
+    }
+    return out_n;
+}
+isize kg_spsc_ring_len(kg_spsc_ring_t* r) {
+    return kg_atomic_load(&r->write_pos) - kg_atomic_load(&r->read_pos);
+}
+isize kg_spsc_ring_cap(const kg_spsc_ring_t* r) {
+    return r && r->ptr ? r->mask + 1 : 0;
+}
+isize kg_spsc_ring_mem_size(const kg_spsc_ring_t* r) {
+    return kg_spsc_ring_cap(r) * (r ? r->stride : 0);
+}
+void kg_spsc_ring_destroy(kg_spsc_ring_t* r) {
+    if (r) {
+        kg_allocator_free(r->allocator, r->ptr, kg_spsc_ring_mem_size(r));
+        kg_mem_zero(r, kg_sizeof(kg_spsc_ring_t));
+    }
+}
+
 kg_inline void kg_exit(i32 code) {
     exit(code);
 }
@@ -2125,9 +5159,8 @@ kg_file_content_t kg_file_content_read(kg_allocator_t* a, const char* filename)
     if (kg_file_open(&f, filename, KG_FILE_MODE_READ, false)) {
         isize size = kg_file_size(&f);
         if (size >= 0) {
-            out_content.cstr = kg_cast(char*)kg_allocator_alloc(a, size + 1);
+            out_content.cstr = kg_cast(char*)kg_allocator_alloc_uninit(a, size + 1);
             if (out_content.cstr) {
-                kg_mem_zero(out_content.cstr, size + 1);
                 isize bytes_read = fread(out_content.cstr, 1, size, kg_cast(FILE*)f.handle);
                 out_content.len = bytes_read;
                 out_content.cstr[out_content.len] = '\0';
@@ -2352,8 +5385,16 @@ void kg_assert_handler(const char* prefix, const char* condition, const char* fi
 #ifdef KG_THREADS
 
 #include <pthread.h>
+#include <sched.h>
 #include <semaphore.h>
 #include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+b32  kg_futex_wait(u32* addr, u32 expected);
+void kg_futex_wake(u32* addr, i32 n);
 
 typedef struct kg_sema_t {
     sem_t unix_handle;
@@ -2400,6 +5441,7 @@ b32  kg_thread_create (kg_thread_t* t, kg_thread_fn_t fn, void* user_data);
 b32  kg_thread_join   (kg_thread_t* t);
 b32  kg_thread_detach (kg_thread_t* t);
 i32  kg_thread_id     (void);
+void kg_thread_yield  (void);
 void kg_thread_destroy(kg_thread_t* t);
 
 typedef struct kg_task_t {
@@ -2407,9 +5449,11 @@ typedef struct kg_task_t {
     void*          arg;
 } kg_task_t;
 
+KG_QUEUE_TYPEDEF(kg_task_t, task)
+
 typedef struct kg_pool_t {
     kg_allocator_t* allocator;
-    kg_queue_t      task_queue;
+    kg_queue_task_t task_queue;
     kg_mutex_t      work_mutex;
     kg_cond_t       work_cond;
     kg_cond_t       working_cond;
@@ -2424,10 +5468,250 @@ b32  kg_pool_add_task(kg_pool_t* p, kg_thread_fn_t fn, void* arg);
 b32  kg_pool_join    (kg_pool_t* p);
 void kg_pool_destroy (kg_pool_t* p);
 
+// Counts outstanding work, kg_wait_group_wait sleeps on the counter until it drops to zero.
+// Lets a caller wait for its own batch of pool tasks without joining the whole pool.
+typedef struct kg_wait_group_t {
+    u32 count;
+} kg_wait_group_t;
+
+void kg_wait_group_add (kg_wait_group_t* wg, isize n);
+void kg_wait_group_done(kg_wait_group_t* wg);
+void kg_wait_group_wait(kg_wait_group_t* wg);
+
+#define KG_PARALLEL_SORT_MIN_LEN 16384
+
+typedef struct kg_parallel_sort_task_t {
+    void*            a;
+    isize            a_len;
+    void*            b;
+    isize            b_len;
+    void*            dst;
+    isize            begin;
+    isize            end;
+    kg_wait_group_t* wg;
+} kg_parallel_sort_task_t;
+
+// Parallel merge sort over a kg_pool_t, needs KG_SORT_TYPEDEF(T, name, less) first.
+// Every worker sorts one run with kg_sort_##name, then runs are merged pairwise (an odd
+// run is carried to the next round) and each merge is cut along its merge path into
+// independent pieces so all workers stay busy. Small inputs and single worker pools go
+// straight to kg_sort_##name. When the scratch memory can't be allocated the data is
+// still sorted with kg_sort_##name but false is returned.
+// Must not be called from inside a task of the same pool.
+#define KG_PARALLEL_SORT_TYPEDEF(T, name, less) \
+    kg_static kg_inline isize kg_parallel_sort_##name##_split_(const T* a, isize a_len, const T* b, isize b_len, isize d) { \
+        isize lo = kg_max(0, d - b_len); \
+        isize hi = kg_min(d, a_len); \
+        while (lo < hi) { \
+            isize mid = lo + (hi - lo) / 2; \
+            if (less(b[d - mid - 1], a[mid])) { \
+                hi = mid; \
+            } else { \
+                lo = mid + 1; \
+            } \
+        } \
+        return lo; \
+    } \
+    kg_static void* kg_parallel_sort_##name##_sort_task_(void* arg) { \
+        kg_parallel_sort_task_t* t = kg_cast(kg_parallel_sort_task_t*)arg; \
+        kg_sort_##name(kg_cast(T*)t->a, t->a_len); \
+        kg_wait_group_done(t->wg); \
+        return null; \
+    } \
+    kg_static void* kg_parallel_sort_##name##_merge_task_(void* arg) { \
+        kg_parallel_sort_task_t* t = kg_cast(kg_parallel_sort_task_t*)arg; \
+        const T* a = kg_cast(const T*)t->a; \
+        const T* b = kg_cast(const T*)t->b; \
+        T* dst = kg_cast(T*)t->dst; \
+        isize i = kg_parallel_sort_##name##_split_(a, t->a_len, b, t->b_len, t->begin); \
+        isize j = t->begin - i; \
+        isize i_end = kg_parallel_sort_##name##_split_(a, t->a_len, b, t->b_len, t->end); \
+        isize j_end = t->end - i_end; \
+        isize k = t->begin; \
+        while (i < i_end && j < j_end) { \
+            dst[k++] = less(b[j], a[i]) ? b[j++] : a[i++]; \
+        } \
+        while (i < i_end) { dst[k++] = a[i++]; } \
+        while (j < j_end) { dst[k++] = b[j++]; } \
+        kg_wait_group_done(t->wg); \
+        return null; \
+    } \
+    kg_static kg_inline b32 kg_parallel_sort_##name(kg_pool_t* p, kg_allocator_t* allocator, T* data, isize n) { \
+        isize runs = p ? p->workers_n : 0; \
+        T* scratch = null; \
+        kg_parallel_sort_task_t* tasks = null; \
+        isize* bounds = null; \
+        if (n >= KG_PARALLEL_SORT_MIN_LEN && runs >= 2) { \
+            scratch = kg_allocator_alloc_uninit(allocator, n * kg_sizeof(T)); \
+            tasks = kg_allocator_alloc_uninit(allocator, runs * kg_sizeof(kg_parallel_sort_task_t)); \
+            bounds = kg_allocator_alloc_uninit(allocator, (runs + 1) * kg_sizeof(isize)); \
+        } \
+        b32 out_ok = n < KG_PARALLEL_SORT_MIN_LEN || runs < 2 || (scratch && tasks && bounds); \
+        if (!scratch || !tasks || !bounds) { \
+            kg_sort_##name(data, n); \
+        } else { \
+            isize workers = runs; \
+            kg_wait_group_t wg = {0}; \
+            kg_wait_group_add(&wg, runs); \
+            for (isize r = 0; r <= runs; r++) { \
+                bounds[r] = r * n / runs; \
+            } \
+            for (isize r = 0; r < runs; r++) { \
+                tasks[r] = (kg_parallel_sort_task_t){.a = data + bounds[r], .a_len = bounds[r + 1] - bounds[r], .wg = &wg}; \
+                if (!kg_pool_add_task(p, kg_parallel_sort_##name##_sort_task_, &tasks[r])) { \
+                    kg_parallel_sort_##name##_sort_task_(&tasks[r]); \
+                } \
+            } \
+            kg_wait_group_wait(&wg); \
+            T* src = data; \
+            T* dst = scratch; \
+            for (isize cur_runs = runs; cur_runs > 1; cur_runs = (cur_runs + 1) / 2) { \
+                isize pairs = (cur_runs + 1) / 2; \
+                isize parts = kg_max(1, workers / pairs); \
+                isize tasks_len = 0; \
+                for (isize pair = 0; pair < pairs; pair++) { \
+                    isize a_begin = bounds[2 * pair]; \
+                    isize b_begin = bounds[2 * pair + 1]; \
+                    isize b_end = 2 * pair + 2 <= cur_runs ? bounds[2 * pair + 2] : b_begin; \
+                    isize len = b_end - a_begin; \
+                    for (isize part = 0; part < parts; part++) { \
+                        tasks[tasks_len++] = (kg_parallel_sort_task_t){ \
+                            .a     = src + a_begin, \
+                            .a_len = b_begin - a_begin, \
+                            .b     = src + b_begin, \
+                            .b_len = b_end - b_begin, \
+                            .dst   = dst + a_begin, \
+                            .begin = part * len / parts, \
+                            .end   = (part + 1) * len / parts, \
+                            .wg    = &wg, \
+                        }; \
+                    } \
+                } \
+                kg_wait_group_add(&wg, tasks_len); \
+                for (isize t = 0; t < tasks_len; t++) { \
+                    if (!kg_pool_add_task(p, kg_parallel_sort_##name##_merge_task_, &tasks[t])) { \
+                        kg_parallel_sort_##name##_merge_task_(&tasks[t]); \
+                    } \
+                } \
+                kg_wait_group_wait(&wg); \
+                for (isize pair = 0; pair <= pairs; pair++) { \
+                    bounds[pair] = 2 * pair <= cur_runs ? bounds[2 * pair] : n; \
+                } \
+                T* swap = src; src = dst; dst = swap; \
+            } \
+            if (src != data) { \
+                kg_mem_copy(data, src, n * kg_sizeof(T)); \
+            } \
+        } \
+        if (scratch) { kg_allocator_free(allocator, scratch, n * kg_sizeof(T)); } \
+        if (tasks) { kg_allocator_free(allocator, tasks, runs * kg_sizeof(kg_parallel_sort_task_t)); } \
+        if (bounds) { kg_allocator_free(allocator, bounds, (runs + 1) * kg_sizeof(isize)); } \
+        return out_ok; \
+    }
+
+// Bounded lock free queue, every slot carries a sequence number that tells producers
+// and consumers whose turn it is (Vyukov). Blocking calls sleep on a futex only when
+// the queue is full or empty, the waiters counters keep the fast path syscall free.
+typedef struct kg_mpmc_queue_t {
+    kg_allocator_t* allocator;
+    u8*             slots;
+    isize           mask;
+    isize           stride;
+    isize           slot_stride;
+    u8              pad0_[KG_CACHE_LINE_SIZE];
+    isize           enqueue_pos;
+    u8              pad1_[KG_CACHE_LINE_SIZE - kg_sizeof(isize)];
+    isize           deque_pos;
+    u8              pad2_[KG_CACHE_LINE_SIZE - kg_sizeof(isize)];
+    u32             not_empty_epoch;
+    i32             not_empty_waiters;
+    u32             not_full_epoch;
+    i32             not_full_waiters;
+    u8              pad3_[KG_CACHE_LINE_SIZE - 4 * kg_sizeof(u32)];
+} kg_mpmc_queue_t;
+
+b32   kg_mpmc_queue_create     (kg_mpmc_queue_t* q, kg_allocator_t* a, isize stride, isize cap);
+b32   kg_mpmc_queue_try_enqueue(kg_mpmc_queue_t* q, const void* o);
+b32   kg_mpmc_queue_try_deque  (kg_mpmc_queue_t* q, void* o);
+void  kg_mpmc_queue_enqueue    (kg_mpmc_queue_t* q, const void* o);
+void  kg_mpmc_queue_deque      (kg_mpmc_queue_t* q, void* o);
+isize kg_mpmc_queue_len        (kg_mpmc_queue_t* q);
+isize kg_mpmc_queue_cap        (const kg_mpmc_queue_t* q);
+void  kg_mpmc_queue_destroy    (kg_mpmc_queue_t* q);
+
+#define KG_THREAD_HEAP_BATCH_LEN 32
+#define KG_THREAD_HEAP_BIN_MAX   128
+#define KG_THREAD_HEAP_TLS_LEN   8
+
+typedef struct kg_thread_heap_bin_t {
+    void* head;
+    isize len;
+} kg_thread_heap_bin_t;
+
+typedef struct kg_thread_heap_cache_t kg_thread_heap_cache_t;
+
+// Every thread keeps one cache per heap on h->caches, found through a small thread local table.
+// A cache evicted from that table is looked up again by owner, so its blocks are never stranded.
+// free_all bumps the generation and each thread drops its bins lazily on its next access.
+typedef struct kg_thread_heap_cache_t {
+    kg_thread_heap_cache_t* next;
+    void*                   owner;
+    isize                   generation;
+    kg_thread_heap_bin_t    bins[KG_HEAP_CLASSES_LEN];
+} kg_thread_heap_cache_t;
+
+typedef struct kg_thread_heap_t {
+    kg_heap_t               central;
+    kg_mutex_t              mutex;
+    kg_thread_heap_cache_t* caches;
+    isize                   id;
+    isize                   generation;
+} kg_thread_heap_t;
+
+b32   kg_thread_heap_create      (kg_thread_heap_t* h, kg_allocator_t* allocator);
+void* kg_thread_heap_alloc       (kg_thread_heap_t* h, isize size);
+void* kg_thread_heap_alloc_uninit(kg_thread_heap_t* h, isize size);
+b32   kg_thread_heap_alloc_batch (kg_thread_heap_t* h, isize size, isize n, void** out_ptrs);
+void  kg_thread_heap_free        (kg_thread_heap_t* h, void* ptr, isize size);
+void  kg_thread_heap_free_batch  (kg_thread_heap_t* h, void** ptrs, isize n, isize size);
+void* kg_thread_heap_resize      (kg_thread_heap_t* h, void* ptr, isize old_size, isize new_size);
+void  kg_thread_heap_flush       (kg_thread_heap_t* h);
+void  kg_thread_heap_destroy     (kg_thread_heap_t* h);
+
+kg_allocator_t kg_allocator_thread_heap(kg_thread_heap_t* h);
+
+#define KG_THREAD_INTERNER_SHARDS_LEN 16
+#define KG_THREAD_INTERNER_SHARD_BITS 4
+
+// Strings are spread over mutex guarded shards by hash, the shard index is kept in
+// the low bits of the id so kg_thread_interner_str finds it again.
+typedef struct kg_thread_interner_shard_t {
+    kg_mutex_t    mutex;
+    kg_interner_t interner;
+} kg_thread_interner_shard_t;
+
+typedef struct kg_thread_interner_t {
+    kg_thread_interner_shard_t shards[KG_THREAD_INTERNER_SHARDS_LEN];
+} kg_thread_interner_t;
+
+b32      kg_thread_interner_create    (kg_thread_interner_t* t, kg_allocator_t* a, isize block_size);
+u32      kg_thread_interner_intern    (kg_thread_interner_t* t, const kg_str_t s);
+kg_str_t kg_thread_interner_intern_str(kg_thread_interner_t* t, const kg_str_t s);
+kg_str_t kg_thread_interner_str       (kg_thread_interner_t* t, u32 id);
+isize    kg_thread_interner_len       (kg_thread_interner_t* t);
+void     kg_thread_interner_destroy   (kg_thread_interner_t* t);
+
 #endif // KG_THREADS
 
 #ifdef KG_THREADS_IMPL
 
+b32 kg_futex_wait(u32* addr, u32 expected) {
+    return syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, null, null, 0) == 0;
+}
+void kg_futex_wake(u32* addr, i32 n) {
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, n, null, null, 0);
+}
+
 b32 kg_sema_create(kg_sema_t* s) {
     return s ? sem_init(&s->unix_handle, 0, 0) == 0 : false;
 }
@@ -2535,6 +5819,9 @@ b32 kg_thread_detach(kg_thread_t* t) {
     out_ok = pthread_detach(t->posix_handle) == 0;
     return out_ok;
 }
+void kg_thread_yield(void) {
+    sched_yield();
+}
 i32 kg_thread_id(void) {
     return pthread_self();
 }
@@ -2552,14 +5839,14 @@ void* kg_pool_loop_(void* arg) {
     kg_task_t task = {0};
     while (true) {
         kg_mutex_lock(&p->work_mutex);
-        while (kg_queue_is_empty(&p->task_queue) && !p->stop) {
+        while (kg_queue_task_is_empty(&p->task_queue) && !p->stop) {
             kg_cond_wait(&p->work_cond, &p->work_mutex);
         }
         if (p->stop) {
             kg_mutex_unlock(&p->work_mutex);
             break;
         }
-        b32 has_task = kg_queue_deque(&p->task_queue, &task);
+        b32 has_task = kg_queue_task_deque(&p->task_queue, &task);
         p->working_count++;
         kg_mutex_unlock(&p->work_mutex);
         if (has_task && task.fn) {
@@ -2567,7 +5854,7 @@ void* kg_pool_loop_(void* arg) {
         }
         kg_mutex_lock(&p->work_mutex);
         p->working_count--;
-        if (!p->stop && p->working_count == 0 && kg_queue_is_empty(&p->task_queue)) {
+        if (!p->stop && p->working_count == 0 && kg_queue_task_is_empty(&p->task_queue)) {
             kg_cond_signal(&p->working_cond);
         }
         kg_mutex_unlock(&p->work_mutex);
@@ -2587,7 +5874,8 @@ b32 kg_pool_create(kg_pool_t* p, kg_allocator_t* a, isize n) {
             if (!kg_mutex_create(&p->work_mutex)) goto cleanup;
             if (!kg_cond_create(&p->work_cond)) goto cleanup;
             if (!kg_cond_create(&p->working_cond)) goto cleanup;
-            if (!kg_queue_create(&p->task_queue, p->allocator, kg_sizeof(kg_task_t), initial_queue_cap)) goto cleanup;
+            p->task_queue = kg_queue_task_create(p->allocator, initial_queue_cap);
+            if (!p->task_queue.ptr) goto cleanup;
             for (isize i = 0; i < p->workers_n; i++) {
                 if (!kg_thread_create(&p->workers[i], kg_pool_loop_, p)) goto cleanup;
             }
@@ -2610,7 +5898,7 @@ b32 kg_pool_add_task(kg_pool_t* p, kg_thread_fn_t fn, void* arg) {
             .fn = fn,
             .arg = arg,
         };
-        out_ok = kg_queue_enqueue(&p->task_queue, &task);
+        out_ok = kg_queue_task_enqueue(&p->task_queue, task);
         kg_cond_signal(&p->work_cond);
         kg_mutex_unlock(&p->work_mutex);
     }
@@ -2620,7 +5908,7 @@ b32 kg_pool_join(kg_pool_t* p) {
     b32 out_ok = true;
     kg_mutex_lock(&p->work_mutex);
     while (true) {
-        if (!kg_queue_is_empty(&p->task_queue) || p->working_count > 0) {
+        if (!kg_queue_task_is_empty(&p->task_queue) || p->working_count > 0) {
             kg_cond_wait(&p->working_cond, &p->work_mutex);
         } else {
             break;
@@ -2642,7 +5930,7 @@ void kg_pool_destroy(kg_pool_t* p) {
         for (isize i = 0; i < p->workers_n; i++) {
             kg_thread_destroy(&p->workers[i]);
         }
-        kg_queue_destroy(&p->task_queue);
+        kg_queue_task_destroy(&p->task_queue);
         if (p->workers) {
             kg_allocator_free(p->allocator, p->workers, kg_sizeof(kg_thread_t) * p->workers_n);
         }
@@ -2650,6 +5938,478 @@ void kg_pool_destroy(kg_pool_t* p) {
     }
 }
 
+b32 kg_mpmc_queue_create(kg_mpmc_queue_t* q, kg_allocator_t* a, isize stride, isize cap) {
+    b32 out_ok = false;
+    if (q && a && stride > 0 && kg_is_power_of_two(cap)) {
+        *q = (kg_mpmc_queue_t){
+            .allocator   = a,
+            .mask        = cap - 1,
+            .stride      = stride,
+            .slot_stride = kg_align_up(kg_sizeof(isize) + stride, kg_sizeof(isize)),
+        };
+        q->slots = kg_allocator_alloc_uninit(a, q->slot_stride * cap);
+        if (q->slots) {
+            for (isize i = 0; i < cap; i++) {
+                *kg_cast(isize*)(q->slots + i * q->slot_stride) = i;
+            }
+            out_ok = true;
+        }
+    }
+    return out_ok;
+}
+b32 kg_mpmc_queue_try_enqueue(kg_mpmc_queue_t* q, const void* o) {
+    isize pos = kg_atomic_load_relaxed(&q->enqueue_pos);
+    isize* seq = null;
+    for (;;) {
+        seq = kg_cast(isize*)(q->slots + (pos & q->mask) * q->slot_stride);
+        isize dif = kg_atomic_load(seq) - pos;
+        if (dif == 0) {
+            if (kg_atomic_cas(&q->enqueue_pos, &pos, pos + 1)) {
+                break;
+            }
+        } else if (dif < 0) {
+            return false;
+        } else {
+            pos = kg_atomic_load_relaxed(&q->enqueue_pos);
+        }
+    }
+    kg_mem_copy(seq + 1, o, q->stride);
+    kg_atomic_store(seq, pos + 1);
+    kg_atomic_fence();
+    if (kg_atomic_load_relaxed(&q->not_empty_waiters) > 0) {
+        kg_atomic_fetch_add(&q->not_empty_epoch, 1);
+        kg_futex_wake(&q->not_empty_epoch, 1);
+    }
+    return true;
+}
+b32 kg_mpmc_queue_try_deque(kg_mpmc_queue_t* q, void* o) {
+    isize pos = kg_atomic_load_relaxed(&q->deque_pos);
+    isize* seq = null;
+    for (;;) {
+        seq = kg_cast(isize*)(q->slots + (pos & q->mask) * q->slot_stride);
+        isize dif = kg_atomic_load(seq) - (pos + 1);
+        if (dif == 0) {
+            if (kg_atomic_cas(&q->deque_pos, &pos, pos + 1)) {
+                break;
+            }
+        } else if (dif < 0) {
+            return false;
+        } else {
+            pos = kg_atomic_load_relaxed(&q->deque_pos);
+        }
+    }
+    kg_mem_copy(o, seq + 1, q->stride);
+    kg_atomic_store(seq, pos + q->mask + 1);
+    kg_atomic_fence();
+    if (kg_atomic_load_relaxed(&q->not_full_waiters) > 0) {
+        kg_atomic_fetch_add(&q->not_full_epoch, 1);
+        kg_futex_wake(&q->not_full_epoch, 1);
+    }
+    return true;
+}
+// The waiter is registered before the last try, so a producer that misses it has
+// already published and the try succeeds, otherwise the epoch bump wakes the futex.
+void kg_mpmc_queue_enqueue(kg_mpmc_queue_t* q, const void* o) {
+    while (!kg_mpmc_queue_try_enqueue(q, o)) {
+        kg_atomic_fetch_add(&q->not_full_waiters, 1);
+        kg_atomic_fence();
+        u32 epoch = kg_atomic_load(&q->not_full_epoch);
+        if (kg_mpmc_queue_try_enqueue(q, o)) {
+            kg_atomic_fetch_sub(&q->not_full_waiters, 1);
+            return;
+        }
+        kg_futex_wait(&q->not_full_epoch, epoch);
+        kg_atomic_fetch_sub(&q->not_full_waiters, 1);
+    }
+}
+void kg_mpmc_queue_deque(kg_mpmc_queue_t* q, void* o) {
+    while (!kg_mpmc_queue_try_deque(q, o)) {
+        kg_atomic_fetch_add(&q->not_empty_waiters, 1);
+        kg_atomic_fence();
+        u32 epoch = kg_atomic_load(&q->not_empty_epoch);
+        if (kg_mpmc_queue_try_deque(q, o)) {
+            kg_atomic_fetch_sub(&q->not_empty_waiters, 1);
+            return;
+        }
+        kg_futex_wait(&q->not_empty_epoch, epoch);
+        kg_atomic_fetch_sub(&q->not_empty_waiters, 1);
+    }
+}
+isize kg_mpmc_queue_len(kg_mpmc_queue_t* q) {
+    isize len = kg_atomic_load(&q->enqueue_pos) - kg_atomic_load(&q->deque_pos);
+    return kg_clamp(len, 0, q->mask + 1);
+}
+isize kg_mpmc_queue_cap(const kg_mpmc_queue_t* q) {
+    return q && q->slots ? q->mask + 1 : 0;
+}
+void kg_mpmc_queue_destroy(kg_mpmc_queue_t* q) {
+    if (q) {
+        kg_allocator_free(q->allocator, q->slots, q->slot_stride * kg_mpmc_queue_cap(q));
+        kg_mem_zero(q, kg_sizeof(kg_mpmc_queue_t));
+    }
+}
+
+void kg_wait_group_add(kg_wait_group_t* wg, isize n) {
+    kg_atomic_fetch_add(&wg->count, kg_cast(u32)n);
+}
+void kg_wait_group_done(kg_wait_group_t* wg) {
+    if (kg_atomic_fetch_sub(&wg->count, 1) == 1) {
+        kg_futex_wake(&wg->count, INT_MAX);
+    }
+}
+void kg_wait_group_wait(kg_wait_group_t* wg) {
+    u32 count = kg_atomic_load(&wg->count);
+    while (count != 0) {
+        kg_futex_wait(&wg->count, count);
+        count = kg_atomic_load(&wg->count);
+    }
+}
+
+kg_static isize kg_thread_heap_next_id_ = 1;
+kg_static _Thread_local struct {
+    isize                   heap_id;
+    kg_thread_heap_cache_t* cache;
+} kg_thread_heap_tls_[KG_THREAD_HEAP_TLS_LEN];
+kg_static _Thread_local isize kg_thread_heap_tls_evict_;
+
+b32 kg_thread_heap_create(kg_thread_heap_t* h, kg_allocator_t* allocator) {
+    b32 out_ok = false;
+    if (h && allocator) {
+        *h = (kg_thread_heap_t){
+            .id = kg_atomic_fetch_add(&kg_thread_heap_next_id_, 1),
+        };
+        out_ok = kg_heap_create(&h->central, allocator) && kg_mutex_create(&h->mutex);
+    }
+    return out_ok;
+}
+kg_static kg_thread_heap_cache_t* kg_thread_heap_cache_(kg_thread_heap_t* h) {
+    kg_thread_heap_cache_t* out = null;
+    isize slot = -1;
+    for (isize i = 0; i < KG_THREAD_HEAP_TLS_LEN; i++) {
+        if (kg_thread_heap_tls_[i].heap_id == h->id) {
+            out = kg_thread_heap_tls_[i].cache;
+            break;
+        }
+        if (slot < 0 && kg_thread_heap_tls_[i].heap_id == 0) {
+            slot = i;
+        }
+    }
+    if (!out) {
+        void* owner = kg_thread_heap_tls_;
+        kg_mutex_lock(&h->mutex);
+        for (kg_thread_heap_cache_t* cache = h->caches; cache; cache = cache->next) {
+            if (cache->owner == owner) {
+                out = cache;
+                break;
+            }
+        }
+        if (!out) {
+            out = kg_allocator_alloc(h->central.allocator, kg_sizeof(kg_thread_heap_cache_t));
+            if (out) {
+                kg_mem_zero(out, kg_sizeof(kg_thread_heap_cache_t));
+                out->owner = owner;
+                out->generation = h->generation;
+                out->next = h->caches;
+                h->caches = out;
+            }
+        }
+        kg_mutex_unlock(&h->mutex);
+        if (out) {
+            if (slot < 0) {
+                slot = kg_thread_heap_tls_evict_++ % KG_THREAD_HEAP_TLS_LEN;
+            }
+            kg_thread_heap_tls_[slot].heap_id = h->id;
+            kg_thread_heap_tls_[slot].cache = out;
+        }
+    }
+    if (out) {
+        isize generation = kg_atomic_load(&h->generation);
+        if (out->generation != generation) {
+            kg_mem_zero(out->bins, kg_sizeof(out->bins));
+            out->generation = generation;
+        }
+    }
+    return out;
+}
+kg_static void kg_thread_heap_bin_flush_(kg_thread_heap_t* h, kg_thread_heap_bin_t* bin, isize class_index, isize n) {
+    kg_mutex_lock(&h->mutex);
+    while (n-- > 0 && bin->head) {
+        void* ptr = bin->head;
+        bin->head = *kg_cast(void**)ptr;
+        bin->len--;
+        kg_object_pool_free(&h->central.classes[class_index], ptr);
+    }
+    kg_mutex_unlock(&h->mutex);
+}
+kg_static void kg_thread_heap_bin_refill_(kg_thread_heap_t* h, kg_thread_heap_bin_t* bin, isize class_index, isize n) {
+    kg_mutex_lock(&h->mutex);
+    for (isize i = 0; i < n; i++) {
+        void* ptr = kg_object_pool_alloc_uninit(&h->central.classes[class_index]);
+        if (!ptr) {
+            break;
+        }
+        *kg_cast(void**)ptr = bin->head;
+        bin->head = ptr;
+        bin->len++;
+    }
+    kg_mutex_unlock(&h->mutex);
+}
+kg_static void* kg_thread_heap_alloc_(kg_thread_heap_t* h, isize size, b32 zero) {
+    void* out = null;
+    isize class_index = kg_heap_class_index(size);
+    kg_thread_heap_cache_t* cache = class_index >= 0 ? kg_thread_heap_cache_(h) : null;
+    if (cache) {
+        kg_thread_heap_bin_t* bin = &cache->bins[class_index];
+        if (!bin->head) {
+            kg_thread_heap_bin_refill_(h, bin, class_index, KG_THREAD_HEAP_BATCH_LEN);
+        }
+        if (bin->head) {
+            out = bin->head;
+            bin->head = *kg_cast(void**)out;
+            bin->len--;
+            if (zero) {
+                kg_mem_zero(out, size);
+            }
+        }
+    } else if (size > 0) {
+        kg_mutex_lock(&h->mutex);
+        out = zero ? kg_heap_alloc(&h->central, size) : kg_heap_alloc_uninit(&h->central, size);
+        kg_mutex_unlock(&h->mutex);
+    }
+    return out;
+}
+kg_inline void* kg_thread_heap_alloc(kg_thread_heap_t* h, isize size) {
+    return kg_thread_heap_alloc_(h, size, true);
+}
+kg_inline void* kg_thread_heap_alloc_uninit(kg_thread_heap_t* h, isize size) {
+    return kg_thread_heap_alloc_(h, size, false);
+}
+// A missing run of blocks is pulled from the central heap under one lock.
+b32 kg_thread_heap_alloc_batch(kg_thread_heap_t* h, isize size, isize n, void** out_ptrs) {
+    b32 out_ok = true;
+    isize class_index = kg_heap_class_index(size);
+    kg_thread_heap_cache_t* cache = class_index >= 0 && n > 0 ? kg_thread_heap_cache_(h) : null;
+    isize i = 0;
+    if (cache) {
+        kg_thread_heap_bin_t* bin = &cache->bins[class_index];
+        if (bin->len < n) {
+            kg_thread_heap_bin_refill_(h, bin, class_index, kg_max(n - bin->len, KG_THREAD_HEAP_BATCH_LEN));
+        }
+        for (; i < n && bin->head; i++) {
+            out_ptrs[i] = bin->head;
+            bin->head = *kg_cast(void**)out_ptrs[i];
+            bin->len--;
+            kg_mem_zero(out_ptrs[i], size);
+        }
+        out_ok = i == n;
+    } else {
+        for (; i < n; i++) {
+            out_ptrs[i] = kg_thread_heap_alloc(h, size);
+            if (!out_ptrs[i]) {
+                out_ok = false;
+                break;
+            }
+        }
+    }
+    if (!out_ok) {
+        kg_thread_heap_free_batch(h, out_ptrs, i, size);
+    }
+    return out_ok;
+}
+void kg_thread_heap_free(kg_thread_heap_t* h, void* ptr, isize size) {
+    if (ptr) {
+        isize class_index = kg_heap_class_index(size);
+        kg_thread_heap_cache_t* cache = class_index >= 0 ? kg_thread_heap_cache_(h) : null;
+        if (cache) {
+            kg_thread_heap_bin_t* bin = &cache->bins[class_index];
+            *kg_cast(void**)ptr = bin->head;
+            bin->head = ptr;
+            bin->len++;
+            if (bin->len > KG_THREAD_HEAP_BIN_MAX) {
+                kg_thread_heap_bin_flush_(h, bin, class_index, KG_THREAD_HEAP_BATCH_LEN);
+            }
+        } else {
+            kg_mutex_lock(&h->mutex);
+            kg_heap_free(&h->central, ptr, size);
+            kg_mutex_unlock(&h->mutex);
+        }
+    }
+}
+// The blocks go to the thread bin and an overfull bin is trimmed under one lock.
+void kg_thread_heap_free_batch(kg_thread_heap_t* h, void** ptrs, isize n, isize size) {
+    isize class_index = kg_heap_class_index(size);
+    kg_thread_heap_cache_t* cache = class_index >= 0 && n > 0 ? kg_thread_heap_cache_(h) : null;
+    if (cache) {
+        kg_thread_heap_bin_t* bin = &cache->bins[class_index];
+        for (isize i = 0; i < n; i++) {
+            if (ptrs[i]) {
+                *kg_cast(void**)ptrs[i] = bin->head;
+                bin->head = ptrs[i];
+                bin->len++;
+            }
+        }
+        if (bin->len > KG_THREAD_HEAP_BIN_MAX) {
+            kg_thread_heap_bin_flush_(h, bin, class_index, bin->len - KG_THREAD_HEAP_BIN_MAX + KG_THREAD_HEAP_BATCH_LEN);
+        }
+    } else {
+        for (isize i = 0; i < n; i++) {
+            kg_thread_heap_free(h, ptrs[i], size);
+        }
+    }
+}
+void* kg_thread_heap_resize(kg_thread_heap_t* h, void* ptr, isize old_size, isize new_size) {
+    void* out = null;
+    if (ptr == null) {
+        out = kg_thread_heap_alloc(h, new_size);
+    } else if (kg_heap_class_index(old_size) >= 0 && kg_heap_class_index(old_size) == kg_heap_class_index(new_size)) {
+        out = ptr;
+    } else {
+        out = kg_thread_heap_alloc_uninit(h, new_size);
+        if (out) {
+            kg_mem_copy(out, ptr, kg_min(old_size, new_size));
+            if (new_size > old_size) {
+                kg_mem_zero(kg_cast(u8*)out + old_size, new_size - old_size);
+            }
+            kg_thread_heap_free(h, ptr, old_size);
+        }
+    }
+    return out;
+}
+void kg_thread_heap_flush(kg_thread_heap_t* h) {
+    kg_thread_heap_cache_t* cache = kg_thread_heap_cache_(h);
+    if (cache) {
+        for (isize i = 0; i < KG_HEAP_CLASSES_LEN; i++) {
+            kg_thread_heap_bin_flush_(h, &cache->bins[i], i, cache->bins[i].len);
+        }
+    }
+}
+void kg_thread_heap_destroy(kg_thread_heap_t* h) {
+    if (h) {
+        for (isize i = 0; i < KG_THREAD_HEAP_TLS_LEN; i++) {
+            if (kg_thread_heap_tls_[i].heap_id == h->id) {
+                kg_thread_heap_tls_[i].heap_id = 0;
+                kg_thread_heap_tls_[i].cache = null;
+            }
+        }
+        while (h->caches) {
+            kg_thread_heap_cache_t* next = h->caches->next;
+            kg_allocator_free(h->central.allocator, h->caches, kg_sizeof(kg_thread_heap_cache_t));
+            h->caches = next;
+        }
+        kg_heap_destroy(&h->central);
+        kg_mutex_destroy(&h->mutex);
+        kg_mem_zero(h, kg_sizeof(kg_thread_heap_t));
+    }
+}
+
+void* kg_allocator_thread_heap_alloc(kg_allocator_t* a, isize size) {
+    return kg_thread_heap_alloc(kg_cast(kg_thread_heap_t*)a->context, size);
+}
+void* kg_allocator_thread_heap_alloc_uninit(kg_allocator_t* a, isize size) {
+    return kg_thread_heap_alloc_uninit(kg_cast(kg_thread_heap_t*)a->context, size);
+}
+b32 kg_allocator_thread_heap_alloc_batch(kg_allocator_t* a, isize size, isize n, void** out_ptrs) {
+    return kg_thread_heap_alloc_batch(kg_cast(kg_thread_heap_t*)a->context, size, n, out_ptrs);
+}
+void kg_allocator_thread_heap_free(kg_allocator_t* a, void* ptr, isize size) {
+    kg_thread_heap_free(kg_cast(kg_thread_heap_t*)a->context, ptr, size);
+}
+void kg_allocator_thread_heap_free_batch(kg_allocator_t* a, void** ptrs, isize n, isize size) {
+    kg_thread_heap_free_batch(kg_cast(kg_thread_heap_t*)a->context, ptrs, n, size);
+}
+void kg_allocator_thread_heap_free_all(kg_allocator_t* a, b32 clear) {
+    kg_thread_heap_t* h = kg_cast(kg_thread_heap_t*)a->context;
+    kg_mutex_lock(&h->mutex);
+    kg_atomic_store(&h->generation, h->generation + 1);
+    if (clear) {
+        kg_heap_reset(&h->central);
+    } else {
+        kg_heap_release(&h->central);
+    }
+    kg_mutex_unlock(&h->mutex);
+}
+void* kg_allocator_thread_heap_resize(kg_allocator_t* a, void* ptr, isize old_size, isize new_size) {
+    return kg_thread_heap_resize(kg_cast(kg_thread_heap_t*)a->context, ptr, old_size, new_size);
+}
+kg_inline kg_allocator_t kg_allocator_thread_heap(kg_thread_heap_t* h) {
+    return (kg_allocator_t){
+        .proc = {
+            .alloc        = kg_allocator_thread_heap_alloc,
+            .alloc_uninit = kg_allocator_thread_heap_alloc_uninit,
+            .alloc_batch  = kg_allocator_thread_heap_alloc_batch,
+            .free         = kg_allocator_thread_heap_free,
+            .free_batch   = kg_allocator_thread_heap_free_batch,
+            .free_all     = kg_allocator_thread_heap_free_all,
+            .resize       = kg_allocator_thread_heap_resize,
+        },
+        .context = h,
+    };
+}
+
+b32 kg_thread_interner_create(kg_thread_interner_t* t, kg_allocator_t* a, isize block_size) {
+    b32 out_ok = true;
+    *t = (kg_thread_interner_t){0};
+    isize i = 0;
+    for (; out_ok && i < KG_THREAD_INTERNER_SHARDS_LEN; i++) {
+        kg_thread_interner_shard_t* shard = &t->shards[i];
+        out_ok = kg_interner_create(&shard->interner, a, block_size);
+        if (out_ok && !kg_mutex_create(&shard->mutex)) {
+            kg_interner_destroy(&shard->interner);
+            out_ok = false;
+        }
+    }
+    if (!out_ok) {
+        for (isize j = 0; j < i - 1; j++) {
+            kg_mutex_destroy(&t->shards[j].mutex);
+            kg_interner_destroy(&t->shards[j].interner);
+        }
+    }
+    return out_ok;
+}
+u32 kg_thread_interner_intern(kg_thread_interner_t* t, const kg_str_t s) {
+    u32 out_id = KG_INTERNER_ID_INVALID;
+    u32 shard_index = kg_cast(u32)(kg_str_hash(s) >> (64 - KG_THREAD_INTERNER_SHARD_BITS));
+    kg_thread_interner_shard_t* shard = &t->shards[shard_index];
+    kg_mutex_lock(&shard->mutex);
+    u32 id = kg_interner_intern(&shard->interner, s);
+    kg_mutex_unlock(&shard->mutex);
+    if (id < (KG_INTERNER_ID_INVALID >> KG_THREAD_INTERNER_SHARD_BITS)) {
+        out_id = (id << KG_THREAD_INTERNER_SHARD_BITS) | shard_index;
+    }
+    return out_id;
+}
+kg_str_t kg_thread_interner_intern_str(kg_thread_interner_t* t, const kg_str_t s) {
+    return kg_thread_interner_str(t, kg_thread_interner_intern(t, s));
+}
+kg_str_t kg_thread_interner_str(kg_thread_interner_t* t, u32 id) {
+    kg_str_t out = kg_str_create_null();
+    if (id != KG_INTERNER_ID_INVALID) {
+        kg_thread_interner_shard_t* shard = &t->shards[id & (KG_THREAD_INTERNER_SHARDS_LEN - 1)];
+        kg_mutex_lock(&shard->mutex);
+        out = kg_interner_str(&shard->interner, id >> KG_THREAD_INTERNER_SHARD_BITS);
+        kg_mutex_unlock(&shard->mutex);
+    }
+    return out;
+}
+isize kg_thread_interner_len(kg_thread_interner_t* t) {
+    isize out = 0;
+    for (isize i = 0; i < KG_THREAD_INTERNER_SHARDS_LEN; i++) {
+        kg_thread_interner_shard_t* shard = &t->shards[i];
+        kg_mutex_lock(&shard->mutex);
+        out += kg_interner_len(&shard->interner);
+        kg_mutex_unlock(&shard->mutex);
+    }
+    return out;
+}
+void kg_thread_interner_destroy(kg_thread_interner_t* t) {
+    if (t) {
+        for (isize i = 0; i < KG_THREAD_INTERNER_SHARDS_LEN; i++) {
+            kg_mutex_destroy(&t->shards[i].mutex);
+            kg_interner_destroy(&t->shards[i].interner);
+        }
+    }
+}
+
 #endif // KG_THREADS_IMPL
 
 #ifdef KG_FLAGS
@@ -67,11 +67,264 @@ void test_darray2() {
     kg_darray_isize_destroy(&ns);
 }
 
+void test_darray2_bulk() {
+    kg_allocator_t allocator = kg_allocator_default();
+    kg_darray_i32_t d = kg_darray_i32_create(&allocator, 2);
+    i32 src[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    kgt_expect_true(kg_darray_i32_append_n(&d, src, 8));
+    kgt_expect_eq(kg_darray_i32_len(&d), 8);
+    kgt_expect_true(kg_darray_i32_insert_n(&d, 2, src + 5, 3));
+    i32 inserted[11] = {0, 1, 5, 6, 7, 2, 3, 4, 5, 6, 7};
+    kgt_expect_mem_eq(d.ptr, inserted, kg_sizeof(inserted));
+    kgt_expect_true(kg_darray_i32_insert_n(&d, 11, src, 1));
+    kgt_expect_eq(d.ptr[11], 0);
+    kgt_expect_false(kg_darray_i32_insert_n(&d, 13, src, 1));
+    kgt_expect_true(kg_darray_i32_remove_range(&d, 1, 4));
+    i32 removed[8] = {0, 2, 3, 4, 5, 6, 7, 0};
+    kgt_expect_mem_eq(d.ptr, removed, kg_sizeof(removed));
+    kgt_expect_false(kg_darray_i32_remove_range(&d, 6, 3));
+    kgt_expect_eq(kg_darray_i32_len(&d), 8);
+
+    kgt_expect_true(kg_darray_i32_reserve(&d, 100));
+    kgt_expect_eq(kg_darray_i32_cap(&d), 100);
+    kgt_expect_true(kg_darray_i32_reserve(&d, 10));
+    kgt_expect_eq(kg_darray_i32_cap(&d), 100);
+    kgt_expect_true(kg_darray_i32_shrink(&d));
+    kgt_expect_eq(kg_darray_i32_cap(&d), 8);
+    kgt_expect_mem_eq(d.ptr, removed, kg_sizeof(removed));
+    kg_darray_i32_clear(&d);
+    kgt_expect_eq(kg_darray_i32_len(&d), 0);
+    kgt_expect_true(kg_darray_i32_shrink(&d));
+    kgt_expect_eq(kg_darray_i32_cap(&d), 1);
+    kgt_expect_true(kg_darray_i32_append_n(&d, src, 3));
+    kgt_expect_eq(d.ptr[2], 2);
+    kgt_expect_true(kg_darray_i32_shrink(&d));
+    kgt_expect_true(kg_darray_i32_append_n(&d, d.ptr, kg_darray_i32_len(&d)));
+    i32 doubled[6] = {0, 1, 2, 0, 1, 2};
+    kgt_expect_mem_eq(d.ptr, doubled, kg_sizeof(doubled));
+    kgt_expect_true(kg_darray_i32_shrink(&d));
+    kgt_expect_true(kg_darray_i32_insert_n(&d, 2, d.ptr + 1, 3));
+    i32 self_inserted[9] = {0, 1, 1, 2, 0, 2, 0, 1, 2};
+    kgt_expect_mem_eq(d.ptr, self_inserted, kg_sizeof(self_inserted));
+    kg_darray_i32_destroy(&d);
+}
+
+#define TEST_SOA_PARTICLE_FIELDS(X) X(f32, x) X(f64, y) X(u8, flags) X(u32, id)
+KG_SOA_TYPEDEF(test_particle, TEST_SOA_PARTICLE_FIELDS)
+
+void test_soa() {
+    kg_allocator_t allocator = kg_allocator_default();
+    kg_soa_test_particle_t s = kg_soa_test_particle_create(&allocator, 0);
+    for (isize i = 0; i < 100; i++) {
+        kg_soa_test_particle_row_t row = {.x = kg_cast(f32)i, .y = kg_cast(f64)i * 2.0, .flags = kg_cast(u8)(i % 3), .id = kg_cast(u32)i};
+        kgt_expect_true(kg_soa_test_particle_append(&s, row));
+    }
+    kgt_expect_eq(kg_soa_test_particle_len(&s), 100);
+    kgt_expect_true((kg_soa_test_particle_cap(&s) >= 100));
+    kgt_expect_lt(kg_cast(u8*)s.x - s.mem, KG_SOA_COLUMN_ALIGN);
+    kgt_expect_eq(kg_cast(usize)s.x % KG_SOA_COLUMN_ALIGN, 0);
+    kgt_expect_eq(kg_cast(usize)s.y % KG_SOA_COLUMN_ALIGN, 0);
+    kgt_expect_eq(kg_cast(usize)s.flags % KG_SOA_COLUMN_ALIGN, 0);
+    kgt_expect_eq(kg_cast(usize)s.id % KG_SOA_COLUMN_ALIGN, 0);
+    f64 sum = 0;
+    for (isize i = 0; i < s.len; i++) {
+        sum += s.y[i];
+    }
+    kgt_expect_eq(sum, 9900.0);
+
+    kg_soa_test_particle_row_t row = kg_soa_test_particle_get(&s, 42);
+    kgt_expect_eq(row.x, 42.0f);
+    kgt_expect_eq(row.flags, 0);
+    kgt_expect_eq(row.id, 42);
+    kgt_expect_true(kg_soa_test_particle_swap_remove(&s, 0));
+    row = kg_soa_test_particle_get(&s, 0);
+    kgt_expect_eq(row.id, 99);
+    kgt_expect_eq(row.y, 198.0);
+    kgt_expect_false(kg_soa_test_particle_swap_remove(&s, 99));
+    row.id = 7;
+    kg_soa_test_particle_set(&s, 1, row);
+    kgt_expect_eq(s.id[1], 7);
+    kgt_expect_eq(s.x[1], 99.0f);
+    kgt_expect_true(kg_soa_test_particle_pop(&s));
+    kgt_expect_eq(kg_soa_test_particle_len(&s), 98);
+    kgt_expect_eq(s.id[97], 97);
+    kg_soa_test_particle_destroy(&s);
+    kgt_expect_null(s.mem);
+}
+
+KG_SMALL_DARRAY_TYPEDEF(isize, test_isize, 4)
+
+void test_small_darray() {
+    kg_allocator_t backing_allocator = kg_allocator_default();
+    kg_allocator_tracking_context_t ctx = {
+        .name             = "small_darray",
+        .parent_allocator = &backing_allocator,
+        .quiet            = true,
+    };
+    kg_allocator_t allocator = kg_allocator_tracking(&ctx);
+    kg_small_darray_test_isize_t ns;
+    kgt_expect_true(kg_small_darray_test_isize_create(&ns, &allocator, 0));
+    for (isize i = 0; i < 4; i++) {
+        kgt_expect_true(kg_small_darray_test_isize_append(&ns, i));
+    }
+    kgt_expect_true(kg_small_darray_test_isize_is_inline(&ns));
+    kgt_expect_eq(ctx.alloc_count, 0);
+    kgt_expect_true(kg_small_darray_test_isize_swap_remove(&ns, 0));
+    kgt_expect_eq(kg_small_darray_test_isize_data(&ns)[0], 3);
+    kgt_expect_true(kg_small_darray_test_isize_pop(&ns));
+    kgt_expect_eq(kg_small_darray_test_isize_len(&ns), 2);
+
+    kg_small_darray_test_isize_t moved = ns;
+    for (isize i = 0; i < 30; i++) {
+        kgt_expect_true(kg_small_darray_test_isize_append(&moved, 100 + i));
+    }
+    kgt_expect_false(kg_small_darray_test_isize_is_inline(&moved));
+    kgt_expect_eq(ctx.alloc_count, 1);
+    isize* data = kg_small_darray_test_isize_data(&moved);
+    kgt_expect_eq(data[0], 3);
+    kgt_expect_eq(data[1], 1);
+    kgt_expect_eq(data[31], 129);
+    kgt_expect_eq(kg_small_darray_test_isize_len(&moved), 32);
+    kg_small_darray_test_isize_destroy(&moved);
+    kgt_expect_eq(ctx.current_allocated, 0);
+
+    kg_small_darray_test_isize_t big;
+    kgt_expect_true(kg_small_darray_test_isize_create(&big, &allocator, 16));
+    kgt_expect_false(kg_small_darray_test_isize_is_inline(&big));
+    kgt_expect_eq(kg_small_darray_test_isize_cap(&big), 16);
+    kg_small_darray_test_isize_destroy(&big);
+    kgt_expect_eq(ctx.current_allocated, 0);
+
+    kg_arena_t arena;
+    kgt_expect_true(kg_arena_create(&arena, &backing_allocator, 64));
+    kg_allocator_t small_allocator = kg_allocator_temp(&arena);
+    kg_small_darray_test_isize_t failed;
+    kgt_expect_false(kg_small_darray_test_isize_create(&failed, &small_allocator, 1024));
+    kgt_expect_true(kg_small_darray_test_isize_is_inline(&failed));
+    kgt_expect_eq(kg_small_darray_test_isize_cap(&failed), 4);
+    kgt_expect_true(kg_small_darray_test_isize_append(&failed, 7));
+    kgt_expect_eq(kg_small_darray_test_isize_data(&failed)[0], 7);
+    kg_small_darray_test_isize_destroy(&failed);
+    kg_arena_destroy(&arena);
+}
+
+KG_MAP_TYPEDEF(u64, i64, u64_i64)
+KG_MAP_TYPEDEF_FN(kg_str_t, isize, str_isize, kg_str_hash, kg_str_is_equal)
+
 void test_map() {
-    /*kg_allocator_t allocator = kg_allocator_default();*/
-    /*kg_map_isize_t ns = kg_map_isize_create(&allocator);*/
-    /*kg_map_isize_put(&ns, "key", 4);*/
-    /*kg_map_isize_destroy(&ns);*/
+    kg_allocator_t allocator = kg_allocator_default();
+    kg_map_u64_i64_t m;
+    kgt_expect_true(kg_map_u64_i64_create(&m, &allocator, 0));
+    kgt_expect_eq(kg_map_u64_i64_cap(&m), KG_MAP_MIN_CAP);
+    isize n = 10000;
+    for (isize i = 0; i < n; i++) {
+        kgt_expect_true(kg_map_u64_i64_set(&m, i * 7, -i));
+    }
+    kgt_expect_eq(kg_map_u64_i64_len(&m), n);
+    for (isize i = 0; i < n; i++) {
+        i64* v = kg_map_u64_i64_get(&m, i * 7);
+        kgt_expect_not_null(v);
+        kgt_expect_eq(*v, -i);
+        kgt_expect_false(kg_map_u64_i64_has(&m, i * 7 + 1));
+    }
+    kgt_expect_true(kg_map_u64_i64_set(&m, 7, 100));
+    kgt_expect_eq(*kg_map_u64_i64_get(&m, 7), 100);
+    kgt_expect_eq(kg_map_u64_i64_len(&m), n);
+
+    for (isize i = 0; i < n; i += 2) {
+        kgt_expect_true(kg_map_u64_i64_remove(&m, i * 7));
+    }
+    kgt_expect_false(kg_map_u64_i64_remove(&m, 0));
+    kgt_expect_eq(kg_map_u64_i64_len(&m), n / 2);
+    for (isize i = 0; i < n; i++) {
+        kgt_expect_eq(kg_map_u64_i64_has(&m, i * 7), (i % 2 == 1));
+    }
+
+    isize it = 0;
+    isize count = 0;
+    for (kg_map_u64_i64_entry_t* e = kg_map_u64_i64_next(&m, &it); e; e = kg_map_u64_i64_next(&m, &it)) {
+        kgt_expect_eq(e->key % 14, 7);
+        count++;
+    }
+    kgt_expect_eq(count, n / 2);
+
+    b32 inserted = false;
+    i64* v = kg_map_u64_i64_get_or_insert(&m, 3, &inserted);
+    kgt_expect_true(inserted);
+    kgt_expect_eq(*v, 0);
+    v = kg_map_u64_i64_get_or_insert(&m, 3, &inserted);
+    kgt_expect_false(inserted);
+
+    kg_map_u64_i64_clear(&m);
+    kgt_expect_eq(kg_map_u64_i64_len(&m), 0);
+    kgt_expect_false(kg_map_u64_i64_has(&m, 7));
+    kg_map_u64_i64_destroy(&m);
+}
+
+void test_map_erase_reuses_slots() {
+    kg_allocator_t allocator = kg_allocator_default();
+    kg_map_u64_i64_t m;
+    kgt_expect_true(kg_map_u64_i64_create(&m, &allocator, 100));
+    kgt_expect_true(kg_map_u64_i64_reserve(&m, 1000));
+    isize cap = kg_map_u64_i64_cap(&m);
+    kgt_expect_gte(cap - cap / 8, 1000);
+    for (isize round = 0; round < 100; round++) {
+        for (isize i = 0; i < 1000; i++) {
+            kgt_expect_true(kg_map_u64_i64_set(&m, round * 1000 + i, i));
+        }
+        for (isize i = 0; i < 1000; i++) {
+            kgt_expect_true(kg_map_u64_i64_remove(&m, round * 1000 + i));
+        }
+    }
+    kgt_expect_eq(kg_map_u64_i64_len(&m), 0);
+    kgt_expect_eq(kg_map_u64_i64_cap(&m), cap);
+    kg_map_u64_i64_destroy(&m);
+}
+
+void test_map_str() {
+    kg_allocator_t allocator = kg_allocator_default();
+    kg_map_str_isize_t m;
+    kgt_expect_true(kg_map_str_isize_create(&m, &allocator, 4));
+    char key[] = "key";
+    kgt_expect_true(kg_map_str_isize_set(&m, kg_str_create(key), 4));
+    kgt_expect_true(kg_map_str_isize_set(&m, kg_str_create("other"), 5));
+    kgt_expect_eq(*kg_map_str_isize_get(&m, kg_str_create("key")), 4);
+    kgt_expect_eq(*kg_map_str_isize_get(&m, kg_str_create_n("other key", 5)), 5);
+    kgt_expect_null(kg_map_str_isize_get(&m, kg_str_create("ke")));
+    kgt_expect_eq(kg_map_str_isize_mem_size(&m), kg_map_table_mem_size_(kg_sizeof(kg_map_str_isize_entry_t), 16));
+    kg_map_str_isize_destroy(&m);
+}
+
+void test_interner() {
+    kg_allocator_t allocator = kg_allocator_default();
+    kg_interner_t interner;
+    kgt_expect_true(kg_interner_create(&interner, &allocator, 256));
+
+    char buf[] = "ident";
+    u32 a = kg_interner_intern(&interner, kg_str_create(buf));
+    u32 b = kg_interner_intern(&interner, kg_str_create("other"));
+    kgt_expect_eq(a, 0);
+    kgt_expect_eq(b, 1);
+    buf[0] = 'I';
+    kgt_expect_eq(kg_interner_intern(&interner, kg_str_create("ident")), a);
+    kgt_expect_eq(kg_interner_find(&interner, kg_str_create("Ident")), KG_INTERNER_ID_INVALID);
+
+    kg_str_t s = kg_interner_intern_str(&interner, kg_str_create_n("ident and more", 5));
+    kgt_expect_eq(s.ptr, kg_interner_str(&interner, a).ptr);
+    kgt_expect_true(kg_str_is_equal(s, kg_str_create("ident")));
+    kgt_expect_eq(s.ptr[s.len], '\0');
+    kgt_expect_true(kg_str_is_null(kg_interner_str(&interner, 100)));
+
+    for (isize i = 0; i < 1000; i++) {
+        char name[32];
+        isize len = snprintf(name, kg_sizeof(name), "name_%li", i);
+        kgt_expect_eq(kg_interner_intern(&interner, kg_str_create_n(name, len)), kg_cast(u32)(i + 2));
+    }
+    kgt_expect_eq(kg_interner_len(&interner), 1002);
+    kgt_expect_eq(kg_interner_str(&interner, a).ptr, s.ptr);
+    kgt_expect_true(kg_str_is_equal(kg_interner_str(&interner, 501), kg_str_create("name_499")));
+    kgt_expect_gte(kg_interner_mem_size(&interner), 1000 * 8);
+    kg_interner_destroy(&interner);
 }
 
 void test_file_read_contant() {
@@ -452,6 +705,454 @@ void test_allocator_temp() {
     kgt_expect_null(arena.real_ptr);
 }
 
+void test_arena_chained() {
+    kg_allocator_t backing_allocator = kg_allocator_default();
+    kg_arena_t arena;
+    isize block_size = 256;
+    kgt_expect_true(kg_arena_create_chained(&arena, &backing_allocator, block_size));
+
+    kg_allocator_t temp_allocator = kg_allocator_temp(&arena);
+    void* first = kg_allocator_alloc(&temp_allocator, block_size);
+    kgt_expect_not_null(first);
+    void* second = kg_allocator_alloc(&temp_allocator, block_size * 4);
+    kgt_expect_not_null(second);
+    kgt_expect_eq(kg_arena_allocated(&arena), block_size * 5);
+    kgt_expect_gte(kg_arena_mem_size(&arena), block_size * 5);
+
+    kg_string_t s = kg_string_from_cstr(&temp_allocator, "chained");
+    kgt_expect_cstr_eq(s, "chained");
+
+    kg_arena_reset(&arena);
+    kgt_expect_eq(kg_arena_allocated(&arena), 0);
+    kgt_expect_null(arena.block->prev);
+
+    kg_allocator_free_all(&temp_allocator, false);
+    kgt_expect_null(arena.block);
+}
+
+void test_arena_virtual() {
+    kg_arena_t arena;
+    isize reserve_size = kg_gibibytes(1);
+    kgt_expect_true(kg_arena_create_virtual(&arena, reserve_size));
+    kgt_expect_eq(kg_arena_mem_size(&arena), 0);
+
+    kg_allocator_t temp_allocator = kg_allocator_temp(&arena);
+    u8* mem = kg_allocator_alloc(&temp_allocator, KG_ARENA_COMMIT_SIZE + 16);
+    kgt_expect_not_null(mem);
+    mem[KG_ARENA_COMMIT_SIZE] = 1;
+    kgt_expect_eq(kg_arena_mem_size(&arena), KG_ARENA_COMMIT_SIZE * 2);
+
+    kg_darray_u64_t d = kg_darray_u64_create(&temp_allocator, 4);
+    for (u64 i = 0; i < 1024; i++) {
+        kgt_expect_true(kg_darray_u64_append(&d, i));
+    }
+    kgt_expect_eq(d.ptr[1023], 1023);
+
+    kgt_expect_null(kg_allocator_alloc(&temp_allocator, reserve_size));
+
+    kg_allocator_free_all(&temp_allocator, false);
+    kgt_expect_null(arena.real_ptr);
+}
+
+void test_arena_alloc_align() {
+    kg_allocator_t backing_allocator = kg_allocator_default();
+    kg_arena_t arena;
+    kgt_expect_true(kg_arena_create(&arena, &backing_allocator, 4096));
+
+    void* odd = kg_arena_alloc_align(&arena, 3, 1);
+    kgt_expect_not_null(odd);
+    f64* f = kg_arena_alloc(&arena, kg_sizeof(f64) * 4);
+    kgt_expect_not_null(f);
+    kgt_expect_eq(kg_cast(usize)f % KG_DEFAULT_ALIGNMENT, 0);
+    u8* simd = kg_arena_alloc_align(&arena, 32, 64);
+    kgt_expect_not_null(simd);
+    kgt_expect_eq(kg_cast(usize)simd % 64, 0);
+    kgt_expect_null(kg_arena_alloc_align(&arena, 8, 3));
+
+    kg_arena_destroy(&arena);
+}
+
+void test_arena_temp() {
+    kg_allocator_t backing_allocator = kg_allocator_default();
+    kg_arena_t arena;
+    kgt_expect_true(kg_arena_create(&arena, &backing_allocator, 4096));
+
+    kg_arena_alloc(&arena, 100);
+    isize allocated = kg_arena_allocated(&arena);
+    kg_arena_temp_t temp = kg_arena_temp_begin(&arena);
+    u8* scratch = kg_arena_alloc(&arena, 1000);
+    kgt_expect_not_null(scratch);
+    kg_mem_set(scratch, 0xff, 1000);
+    kg_arena_temp_end(temp);
+    kgt_expect_eq(kg_arena_allocated(&arena), allocated);
+
+    u8* reused = kg_arena_alloc(&arena, 1000);
+    kgt_expect_ptr_eq(reused, scratch);
+    kgt_expect_eq(reused[0], 0);
+    kgt_expect_eq(reused[999], 0);
+    kg_arena_destroy(&arena);
+
+    kgt_expect_true(kg_arena_create_chained(&arena, &backing_allocator, 256));
+    kg_arena_alloc(&arena, 64);
+    temp = kg_arena_temp_begin(&arena);
+    kg_arena_alloc(&arena, 1024);
+    kg_arena_alloc(&arena, 1024);
+    kgt_expect_eq(kg_arena_allocated(&arena), 64 + 1024 * 2);
+    kg_arena_temp_end(temp);
+    kgt_expect_eq(kg_arena_allocated(&arena), 64);
+    kgt_expect_null(arena.block->prev);
+    kgt_expect_eq(kg_arena_mem_size(&arena), 256);
+    kg_arena_destroy(&arena);
+}
+
+void test_arena_reset() {
+    kg_allocator_t backing_allocator = kg_allocator_default();
+    kg_arena_t arena;
+    isize arena_max_size = kg_mebibytes(1);
+    kgt_expect_true(kg_arena_create(&arena, &backing_allocator, arena_max_size));
+
+    u8* mem = kg_arena_alloc(&arena, 100);
+    kg_mem_set(mem, 0xff, 100);
+    kg_arena_reset_no_zero(&arena);
+    kgt_expect_eq(kg_arena_allocated(&arena), 0);
+    kgt_expect_eq(mem[0], 0xff);
+    mem = kg_arena_alloc(&arena, 100);
+    kgt_expect_eq(mem[0], 0);
+    kgt_expect_eq(mem[99], 0);
+
+    kg_mem_set(mem, 0xff, 100);
+    kg_arena_reset(&arena);
+    kgt_expect_eq(arena.dirty_size, 0);
+    kgt_expect_eq(mem[99], 0);
+
+    mem = kg_arena_alloc(&arena, arena_max_size);
+    kg_mem_set(mem, 0xff, arena_max_size);
+    kg_arena_release(&arena, kg_kibibytes(64));
+    kgt_expect_eq(kg_arena_allocated(&arena), 0);
+    kgt_expect_lte(arena.dirty_size, kg_kibibytes(64) + kg_vm_page_size());
+    kgt_expect_lt(arena.released_start, arena.released_end);
+    mem = kg_arena_alloc(&arena, 100);
+    kgt_expect_eq(mem[99], 0);
+    kg_arena_reset(&arena);
+    kgt_expect_eq(arena.dirty_size, 0);
+    kgt_expect_lte(arena.released_start, kg_kibibytes(64) + kg_vm_page_size());
+    mem = kg_arena_alloc(&arena, kg_kibibytes(128));
+    kg_mem_set(mem, 0xff, kg_kibibytes(128));
+    kg_arena_release(&arena, kg_kibibytes(64));
+    kgt_expect_lte(arena.dirty_size, kg_kibibytes(64) + kg_vm_page_size());
+    kg_arena_reset(&arena);
+    mem = kg_arena_alloc(&arena, arena_max_size);
+    kgt_expect_eq(mem[0], 0);
+    kgt_expect_eq(mem[arena_max_size / 2], 0);
+    kgt_expect_eq(mem[arena_max_size - 1], 0);
+    kg_arena_destroy(&arena);
+
+    kgt_expect_true(kg_arena_create_virtual(&arena, kg_gibibytes(1)));
+    mem = kg_arena_alloc(&arena, arena_max_size);
+    kg_mem_set(mem, 0xff, arena_max_size);
+    kgt_expect_eq(kg_arena_mem_size(&arena), arena_max_size);
+    kg_arena_release(&arena, KG_ARENA_COMMIT_SIZE);
+    kgt_expect_eq(kg_arena_mem_size(&arena), KG_ARENA_COMMIT_SIZE);
+    mem = kg_arena_alloc(&arena, arena_max_size);
+    kgt_expect_not_null(mem);
+    kgt_expect_eq(mem[0], 0);
+    kgt_expect_eq(mem[arena_max_size - 1], 0);
+    kg_arena_destroy(&arena);
+}
+
+void test_allocator_alloc_uninit() {
+    kg_allocator_t allocator = kg_allocator_default();
+    kg_arena_t arena;
+    kgt_expect_true(kg_arena_create(&arena, &allocator, 1024));
+    kg_allocator_t temp_allocator = kg_allocator_temp(&arena);
+
+    u8* dirty = kg_allocator_alloc(&temp_allocator, 64);
+    kg_mem_set(dirty, 0xff, 64);
+    kg_arena_reset_no_zero(&arena);
+    u8* uninit = kg_allocator_alloc_uninit(&temp_allocator, 64);
+    kgt_expect_eq(uninit, dirty);
+    kgt_expect_eq(uninit[63], 0xff);
+    kg_arena_reset_no_zero(&arena);
+    u8* zeroed = kg_allocator_alloc(&temp_allocator, 64);
+    kgt_expect_eq(zeroed[63], 0);
+
+    kg_mem_set(zeroed, 0xff, 64);
+    kg_arena_reset_no_zero(&arena);
+    kg_string_t s = kg_string_create(&temp_allocator, 16);
+    kgt_expect_eq(kg_string_len(s), 0);
+    kgt_expect_true(kg_string_is_equal_cstr(s, ""));
+    s = kg_string_from_cstr(&temp_allocator, "abc");
+    kgt_expect_true(kg_string_is_equal_cstr(s, "abc"));
+    kg_arena_destroy(&arena);
+
+    kg_allocator_t fallback_allocator = kg_allocator_default();
+    fallback_allocator.proc.alloc_uninit = null;
+    u8* mem = kg_allocator_alloc_uninit(&fallback_allocator, 64);
+    kgt_expect_not_null(mem);
+    kgt_expect_eq(mem[0], 0);
+    kg_allocator_free(&fallback_allocator, mem, 64);
+}
+
+void test_allocator_batch_expect_(kg_allocator_t* allocator, isize size) {
+    void* ptrs[64];
+    kgt_expect_true(kg_allocator_alloc_batch(allocator, size, 64, ptrs));
+    for (isize i = 0; i < 64; i++) {
+        kgt_expect_not_null(ptrs[i]);
+        kgt_expect_eq(kg_cast(usize)ptrs[i] % kg_sizeof(void*), 0);
+        kgt_expect_eq(*(kg_cast(u8*)ptrs[i] + size - 1), 0);
+        kg_mem_set(ptrs[i], kg_cast(u8)i, size);
+    }
+    for (isize i = 0; i < 64; i++) {
+        kgt_expect_eq(*kg_cast(u8*)ptrs[i], kg_cast(u8)i);
+    }
+    kg_allocator_free_batch(allocator, ptrs, 64, size);
+}
+
+void test_allocator_batch() {
+    kg_allocator_t allocator = kg_allocator_default();
+    test_allocator_batch_expect_(&allocator, 24);
+
+    kg_allocator_t fallback_allocator = kg_allocator_default();
+    fallback_allocator.proc.alloc_batch = null;
+    fallback_allocator.proc.free_batch = null;
+    test_allocator_batch_expect_(&fallback_allocator, 24);
+
+    kg_arena_t arena;
+    kgt_expect_true(kg_arena_create(&arena, &allocator, kg_kibibytes(4)));
+    kg_allocator_t temp_allocator = kg_allocator_temp(&arena);
+    test_allocator_batch_expect_(&temp_allocator, 24);
+    kgt_expect_eq(kg_arena_allocated(&arena), 64 * 32);
+    void* ptrs[64];
+    kgt_expect_false(kg_allocator_alloc_batch(&temp_allocator, 64, 64, ptrs));
+    kg_arena_destroy(&arena);
+
+    kg_allocator_tracking_context_t ctx = {
+        .name             = "batch",
+        .parent_allocator = &allocator,
+        .quiet            = true,
+    };
+    kg_allocator_t tracking_allocator = kg_allocator_tracking(&ctx);
+    test_allocator_batch_expect_(&tracking_allocator, 24);
+    kgt_expect_eq(ctx.alloc_count, 64);
+    kgt_expect_eq(ctx.free_count, 64);
+    kgt_expect_eq(ctx.peak_allocated, 64 * 24);
+    kgt_expect_eq(ctx.current_allocated, 0);
+
+    kg_heap_t h;
+    kgt_expect_true(kg_heap_create(&h, &allocator));
+    kg_allocator_t heap_allocator = kg_allocator_heap(&h);
+    test_allocator_batch_expect_(&heap_allocator, 24);
+    test_allocator_batch_expect_(&heap_allocator, 5000);
+    kgt_expect_eq(h.large_count, 0);
+    kg_heap_destroy(&h);
+
+    kg_object_pool_t p;
+    kgt_expect_true(kg_object_pool_create(&p, &allocator, 24, 16));
+    kg_allocator_t pool_allocator = kg_allocator_object_pool(&p);
+    test_allocator_batch_expect_(&pool_allocator, 24);
+    kgt_expect_eq(p.allocated_count, 0);
+    kgt_expect_false(kg_allocator_alloc_batch(&pool_allocator, 64, 4, ptrs));
+    kg_object_pool_destroy(&p);
+
+    kg_thread_heap_t th;
+    kgt_expect_true(kg_thread_heap_create(&th, &allocator));
+    kg_allocator_t thread_heap_allocator = kg_allocator_thread_heap(&th);
+    test_allocator_batch_expect_(&thread_heap_allocator, 24);
+    isize class_index = kg_heap_class_index(24);
+    kgt_expect_eq(th.caches->bins[class_index].len, 64);
+    kgt_expect_eq(th.central.classes[class_index].allocated_count, 64);
+    test_allocator_batch_expect_(&thread_heap_allocator, kg_kibibytes(64));
+    kg_thread_heap_flush(&th);
+    kgt_expect_eq(th.central.classes[class_index].allocated_count, 0);
+    kg_thread_heap_destroy(&th);
+
+    ctx = (kg_allocator_tracking_context_t){
+        .name             = "batch",
+        .parent_allocator = &allocator,
+        .quiet            = true,
+    };
+    kgt_expect_true(kg_allocator_alloc_batch(&tracking_allocator, 24, 4, ptrs));
+    kg_allocator_free(&tracking_allocator, ptrs[1], 24);
+    ptrs[1] = null;
+    kg_allocator_free_batch(&tracking_allocator, ptrs, 4, 24);
+    kgt_expect_eq(ctx.free_count, 4);
+    kgt_expect_eq(ctx.total_freed, 4 * 24);
+    kgt_expect_eq(ctx.current_allocated, 0);
+}
+
+void test_allocator_temp_resize() {
+    kg_allocator_t backing_allocator = kg_allocator_default();
+    kg_arena_t arena;
+    kgt_expect_true(kg_arena_create(&arena, &backing_allocator, kg_kibibytes(64)));
+    kg_allocator_t temp_allocator = kg_allocator_temp(&arena);
+
+    kg_string_builder_t b;
+    kgt_expect_true(kg_string_builder_create(&b, &temp_allocator, 1));
+    for (isize i = 0; i < 1000; i++) {
+        kgt_expect_true(kg_string_builder_write_char(&b, 'a'));
+    }
+    kgt_expect_eq(kg_string_builder_len(&b), 1000);
+    kgt_expect_eq(arena.resize_copy_count, 0);
+    kgt_expect_gt(arena.resize_in_place_count, 0);
+    kgt_expect_eq(kg_arena_allocated(&arena), kg_string_builder_cap(&b));
+
+    void* other = kg_allocator_alloc(&temp_allocator, 16);
+    kgt_expect_not_null(other);
+    while (kg_string_builder_available(&b) > 0) {
+        kgt_expect_true(kg_string_builder_write_char(&b, 'a'));
+    }
+    kgt_expect_true(kg_string_builder_write_cstr(&b, "copy"));
+    kgt_expect_eq(arena.resize_copy_count, 1);
+    kgt_expect_mem_eq(b.real_ptr + b.len - 8, "aaaacopy", 8);
+
+    void* last = kg_allocator_alloc(&temp_allocator, 64);
+    isize allocated = kg_arena_allocated(&arena);
+    void* shrunk = kg_allocator_resize(&temp_allocator, last, 64, 16);
+    kgt_expect_ptr_eq(shrunk, last);
+    kgt_expect_eq(kg_arena_allocated(&arena), allocated - 48);
+
+    kg_arena_destroy(&arena);
+}
+
+void test_object_pool() {
+    kg_allocator_t backing_allocator = kg_allocator_default();
+    kg_object_pool_t p;
+    isize slots_per_slab = 8;
+    kgt_expect_true(kg_object_pool_create(&p, &backing_allocator, 48, slots_per_slab));
+    kgt_expect_eq(p.slabs_len, 1);
+
+    void* slots[20];
+    for (isize i = 0; i < 20; i++) {
+        slots[i] = kg_object_pool_alloc(&p);
+        kgt_expect_not_null(slots[i]);
+        kgt_expect_eq(kg_cast(usize)slots[i] % KG_DEFAULT_ALIGNMENT, 0);
+        kg_mem_set(slots[i], 0xff, 48);
+    }
+    kgt_expect_eq(p.slabs_len, 3);
+    kgt_expect_eq(p.allocated_count, 20);
+
+    kg_object_pool_free(&p, slots[5]);
+    u8* reused = kg_object_pool_alloc(&p);
+    kgt_expect_ptr_eq(reused, slots[5]);
+    kgt_expect_eq(reused[47], 0);
+
+    kg_allocator_t allocator = kg_allocator_object_pool(&p);
+    kg_string_t s = kg_string_from_cstr(&allocator, "pooled");
+    kgt_expect_not_null(s);
+    kgt_expect_cstr_eq(s, "pooled");
+    kg_string_destroy(s);
+    kgt_expect_null(kg_allocator_alloc(&allocator, 49));
+
+    kg_allocator_free_all(&allocator, true);
+    kgt_expect_eq(p.allocated_count, 0);
+    kgt_expect_ptr_eq(kg_object_pool_alloc(&p), slots[0]);
+    kgt_expect_eq(p.slabs_len, 3);
+
+    kg_allocator_free_all(&allocator, false);
+    kgt_expect_eq(kg_object_pool_mem_size(&p), 0);
+    kgt_expect_not_null(kg_allocator_alloc(&allocator, 8));
+
+    kg_object_pool_destroy(&p);
+    kgt_expect_null(p.slabs);
+}
+
+void test_heap_class_index() {
+    kgt_expect_eq(kg_heap_class_index(1), 0);
+    kgt_expect_eq(kg_heap_class_index(16), 0);
+    kgt_expect_eq(kg_heap_class_index(17), 1);
+    kgt_expect_eq(kg_heap_class_index(64), 3);
+    kgt_expect_eq(kg_heap_class_index(65), 4);
+    kgt_expect_eq(kg_heap_class_index(128), 5);
+    kgt_expect_eq(kg_heap_class_index(129), 6);
+    kgt_expect_eq(kg_heap_class_index(KG_HEAP_CLASS_MAX_SIZE), KG_HEAP_CLASSES_LEN - 1);
+    kgt_expect_eq(kg_heap_class_index(KG_HEAP_CLASS_MAX_SIZE + 1), -1);
+    for (isize size = 1; size <= KG_HEAP_CLASS_MAX_SIZE; size++) {
+        isize class_index = kg_heap_class_index(size);
+        kgt_expect_gte(kg_heap_class_size(class_index), size);
+        if (class_index > 0) {
+            kgt_expect_lt(kg_heap_class_size(class_index - 1), size);
+        }
+    }
+}
+
+void test_allocator_mmap() {
+    kg_allocator_mmap_context_t ctx = {.huge_pages = true};
+    kg_allocator_t allocator = kg_allocator_mmap(&ctx);
+
+    isize old_size = kg_mebibytes(1);
+    u8* ptr = kg_allocator_alloc(&allocator, old_size);
+    kgt_expect_not_null(ptr);
+    kgt_expect_eq(ctx.map_count, 1);
+    kgt_expect_eq(ctx.mapped_size, old_size);
+    ptr[0] = 1;
+    ptr[old_size - 1] = 2;
+
+    isize new_size = kg_mebibytes(64);
+    ptr = kg_allocator_resize(&allocator, ptr, old_size, new_size);
+    kgt_expect_not_null(ptr);
+    kgt_expect_eq(ptr[0], 1);
+    kgt_expect_eq(ptr[old_size - 1], 2);
+    kgt_expect_eq(ptr[new_size - 1], 0);
+    kgt_expect_eq(ctx.remap_count, 1);
+    kgt_expect_eq(ctx.mapped_size, new_size);
+
+    kgt_expect_eq(kg_allocator_resize(&allocator, ptr, new_size, new_size - 1), ptr);
+    kgt_expect_eq(ctx.remap_count, 1);
+    kg_allocator_free(&allocator, ptr, new_size);
+    kgt_expect_eq(ctx.map_count, 0);
+    kgt_expect_eq(ctx.mapped_size, 0);
+
+    kg_string_builder_t b;
+    kgt_expect_true(kg_string_builder_create(&b, &allocator, 16));
+    for (isize i = 0; i < 100000; i++) {
+        kgt_expect_true(kg_string_builder_write_cstr(&b, "0123456789"));
+    }
+    kgt_expect_eq(b.len, 1000000);
+    kgt_expect_eq(b.real_ptr[999999], '9');
+    kg_string_builder_destroy(&b);
+    kgt_expect_eq(ctx.map_count, 0);
+    kgt_expect_eq(ctx.mapped_size, 0);
+}
+
+void test_heap() {
+    kg_allocator_t backing_allocator = kg_allocator_default();
+    kg_heap_t h;
+    kgt_expect_true(kg_heap_create(&h, &backing_allocator));
+    kg_allocator_t allocator = kg_allocator_heap(&h);
+
+    kg_string_t s = kg_string_from_cstr(&allocator, "heap");
+    kgt_expect_cstr_eq(s, "heap");
+    for (isize i = 0; i < 100; i++) {
+        s = kg_string_append_cstr(s, "0123456789");
+        kgt_expect_not_null(s);
+    }
+    kgt_expect_eq(kg_string_len(s), 1004);
+    kgt_expect_cstr_n_eq(s + 994, "0123456789", 10);
+    kg_string_destroy(s);
+
+    kg_darray_u64_t d = kg_darray_u64_create(&allocator, 1);
+    for (u64 i = 0; i < 10000; i++) {
+        kgt_expect_true(kg_darray_u64_append(&d, i));
+    }
+    kgt_expect_eq(d.ptr[9999], 9999);
+    kgt_expect_eq(h.large_count, 1);
+    kg_darray_u64_destroy(&d);
+    kgt_expect_eq(h.large_count, 0);
+
+    void* a = kg_allocator_alloc(&allocator, 24);
+    kg_allocator_free(&allocator, a, 24);
+    kgt_expect_ptr_eq(kg_allocator_alloc(&allocator, 32), a);
+
+    kg_allocator_alloc(&allocator, kg_mebibytes(1));
+    kgt_expect_gt(kg_heap_mem_size(&h), kg_mebibytes(1));
+    kg_allocator_free_all(&allocator, true);
+    kgt_expect_eq(h.large_count, 0);
+    kg_allocator_free_all(&allocator, false);
+    kgt_expect_eq(kg_heap_mem_size(&h), 0);
+
+    kg_heap_destroy(&h);
+}
+
 void test_queue() {
     kg_allocator_t allocator = kg_allocator_default();
     kg_queue_t q;
@@ -470,6 +1171,61 @@ void test_queue() {
     kgt_expect_null(q.real_ptr);
 }
 
+void test_queue_wraparound() {
+    kg_allocator_t allocator = kg_allocator_default();
+    kg_queue_t q;
+    kgt_expect_true(kg_queue_create(&q, &allocator, kg_sizeof(i32), 4));
+    i32 next_in = 0;
+    i32 next_out = 0;
+    for (isize round = 0; round < 8; round++) {
+        for (isize i = 0; i < 3; i++) {
+            kgt_expect_true(kg_queue_enqueue(&q, &next_in));
+            next_in++;
+        }
+        for (isize i = 0; i < 2; i++) {
+            i32 v;
+            kgt_expect_true(kg_queue_deque(&q, &v));
+            kgt_expect_eq(v, next_out);
+            next_out++;
+        }
+    }
+    kgt_expect_eq(kg_queue_len(&q), next_in - next_out);
+    i32 v;
+    while (kg_queue_deque(&q, &v)) {
+        kgt_expect_eq(v, next_out);
+        next_out++;
+    }
+    kgt_expect_eq(next_out, next_in);
+    kgt_expect_true(kg_queue_is_empty(&q));
+    kg_queue_destroy(&q);
+}
+
+KG_QUEUE_TYPEDEF(isize, test_isize)
+
+void test_queue_typed() {
+    kg_allocator_t allocator = kg_allocator_default();
+    kg_queue_test_isize_t q = kg_queue_test_isize_create(&allocator, 2);
+    kgt_expect_not_null(q.ptr);
+    isize v = 0;
+    kgt_expect_false(kg_queue_test_isize_peek(&q, &v));
+    for (isize i = 0; i < 100; i++) {
+        kgt_expect_true(kg_queue_test_isize_enqueue(&q, i));
+        if (i % 3 == 0) {
+            kgt_expect_true(kg_queue_test_isize_deque(&q, &v));
+            kgt_expect_eq(v, i / 3);
+        }
+    }
+    kgt_expect_true(kg_queue_test_isize_peek(&q, &v));
+    kgt_expect_eq(v, 34);
+    for (isize i = 34; i < 100; i++) {
+        kgt_expect_true(kg_queue_test_isize_deque(&q, &v));
+        kgt_expect_eq(v, i);
+    }
+    kgt_expect_true(kg_queue_test_isize_is_empty(&q));
+    kg_queue_test_isize_destroy(&q);
+    kgt_expect_null(q.ptr);
+}
+
 typedef struct {
     kg_mutex_t mutex;
     isize      value;
@@ -500,6 +1256,349 @@ void test_pool() {
     kg_pool_destroy(&p);
 }
 
+typedef struct {
+    kg_allocator_t* allocator;
+    isize           iter;
+    b32             ok;
+} test_thread_heap_task_st_;
+
+void* test_thread_heap_task_(void* arg) {
+    test_thread_heap_task_st_* st = kg_cast(test_thread_heap_task_st_*)arg;
+    st->ok = true;
+    for (isize i = 0; i < st->iter; i++) {
+        isize size = 8 + (i % 64) * 16;
+        u8* mem = kg_allocator_alloc(st->allocator, size);
+        if (!mem || mem[size - 1] != 0) {
+            st->ok = false;
+            break;
+        }
+        kg_mem_set(mem, 0xff, size);
+        kg_string_t s = kg_string_from_fmt(st->allocator, "%li", i);
+        if (!s || kg_str_to_i64(&(i64){0}, kg_str_from_string(s)) == false) {
+            st->ok = false;
+        }
+        kg_string_destroy(s);
+        kg_allocator_free(st->allocator, mem, size);
+    }
+    return null;
+}
+
+void test_thread_heap() {
+    kg_allocator_t backing_allocator = kg_allocator_default();
+    kg_thread_heap_t h;
+    kgt_expect_true(kg_thread_heap_create(&h, &backing_allocator));
+    kg_allocator_t allocator = kg_allocator_thread_heap(&h);
+
+    void* large = kg_allocator_alloc(&allocator, kg_mebibytes(1));
+    kgt_expect_not_null(large);
+    kg_allocator_free(&allocator, large, kg_mebibytes(1));
+
+    kg_pool_t p;
+    isize n = 8;
+    test_thread_heap_task_st_ sts[8];
+    kgt_expect_true(kg_pool_create(&p, &backing_allocator, n));
+    for (isize i = 0; i < n; i++) {
+        sts[i] = (test_thread_heap_task_st_){.allocator = &allocator, .iter = 10000};
+        kgt_expect_true(kg_pool_add_task(&p, test_thread_heap_task_, &sts[i]));
+    }
+    kgt_expect_true(kg_pool_join(&p));
+    for (isize i = 0; i < n; i++) {
+        kgt_expect_true(sts[i].ok);
+    }
+    kg_pool_destroy(&p);
+
+    kg_thread_heap_flush(&h);
+    kg_allocator_free_all(&allocator, false);
+    kgt_expect_eq(kg_heap_mem_size(&h.central), 0);
+    kg_thread_heap_destroy(&h);
+}
+
+void test_thread_heap_tls_eviction() {
+    kg_allocator_t backing_allocator = kg_allocator_default();
+    kg_thread_heap_t heaps[KG_THREAD_HEAP_TLS_LEN + 1];
+    for (isize i = 0; i < KG_THREAD_HEAP_TLS_LEN + 1; i++) {
+        kgt_expect_true(kg_thread_heap_create(&heaps[i], &backing_allocator));
+    }
+    kg_thread_heap_t* h = &heaps[0];
+    void* ptr = kg_thread_heap_alloc(h, 64);
+    kgt_expect_not_null(ptr);
+    kg_thread_heap_free(h, ptr, 64);
+    for (isize i = 1; i < KG_THREAD_HEAP_TLS_LEN + 1; i++) {
+        kg_thread_heap_free(&heaps[i], kg_thread_heap_alloc(&heaps[i], 64), 64);
+    }
+    void* again = kg_thread_heap_alloc(h, 64);
+    kgt_expect_eq(again, ptr);
+    kgt_expect_not_null(h->caches);
+    kgt_expect_null(h->caches->next);
+    kg_thread_heap_free(h, again, 64);
+
+    kg_allocator_t allocator = kg_allocator_thread_heap(h);
+    kg_allocator_free_all(&allocator, false);
+    kgt_expect_eq(h->caches->bins[kg_heap_class_index(64)].len, 32);
+    ptr = kg_thread_heap_alloc(h, 64);
+    kgt_expect_not_null(ptr);
+    kgt_expect_eq(h->caches->generation, 1);
+    kg_thread_heap_free(h, ptr, 64);
+    for (isize i = 0; i < KG_THREAD_HEAP_TLS_LEN + 1; i++) {
+        kg_thread_heap_destroy(&heaps[i]);
+    }
+}
+
+typedef struct {
+    kg_thread_interner_t* interner;
+    u32                   ids[512];
+} test_thread_interner_task_st_;
+
+void* test_thread_interner_task_(void* arg) {
+    test_thread_interner_task_st_* st = kg_cast(test_thread_interner_task_st_*)arg;
+    for (isize i = 0; i < 512; i++) {
+        char name[32];
+        isize len = snprintf(name, kg_sizeof(name), "name_%li", i);
+        st->ids[i] = kg_thread_interner_intern(st->interner, kg_str_create_n(name, len));
+    }
+    return null;
+}
+
+void test_thread_interner() {
+    kg_allocator_t allocator = kg_allocator_default();
+    kg_thread_interner_t interner;
+    kgt_expect_true(kg_thread_interner_create(&interner, &allocator, 1024));
+
+    kg_pool_t p;
+    isize n = 8;
+    test_thread_interner_task_st_ sts[8];
+    kgt_expect_true(kg_pool_create(&p, &allocator, n));
+    for (isize i = 0; i < n; i++) {
+        sts[i].interner = &interner;
+        kgt_expect_true(kg_pool_add_task(&p, test_thread_interner_task_, &sts[i]));
+    }
+    kgt_expect_true(kg_pool_join(&p));
+    kg_pool_destroy(&p);
+
+    kgt_expect_eq(kg_thread_interner_len(&interner), 512);
+    for (isize i = 0; i < 512; i++) {
+        for (isize j = 1; j < n; j++) {
+            kgt_expect_eq(sts[j].ids[i], sts[0].ids[i]);
+        }
+        char name[32];
+        isize len = snprintf(name, kg_sizeof(name), "name_%li", i);
+        kgt_expect_true(kg_str_is_equal(kg_thread_interner_str(&interner, sts[0].ids[i]), kg_str_create_n(name, len)));
+    }
+    kg_thread_interner_destroy(&interner);
+}
+
+void test_mpmc_queue() {
+    kg_allocator_t allocator = kg_allocator_default();
+    kg_mpmc_queue_t q;
+    kgt_expect_false(kg_mpmc_queue_create(&q, &allocator, kg_sizeof(isize), 6));
+    kgt_expect_true(kg_mpmc_queue_create(&q, &allocator, kg_sizeof(isize), 4));
+    isize v = 0;
+    kgt_expect_false(kg_mpmc_queue_try_deque(&q, &v));
+    for (isize round = 0; round < 3; round++) {
+        for (isize i = 0; i < 4; i++) {
+            kgt_expect_true(kg_mpmc_queue_try_enqueue(&q, &i));
+        }
+        kgt_expect_false(kg_mpmc_queue_try_enqueue(&q, &v));
+        kgt_expect_eq(kg_mpmc_queue_len(&q), 4);
+        for (isize i = 0; i < 4; i++) {
+            kgt_expect_true(kg_mpmc_queue_try_deque(&q, &v));
+            kgt_expect_eq(v, i);
+        }
+        kgt_expect_eq(kg_mpmc_queue_len(&q), 0);
+    }
+    kg_mpmc_queue_destroy(&q);
+    kgt_expect_null(q.slots);
+}
+
+#define TEST_MPMC_THREADS_LEN 4
+#define TEST_MPMC_ITER        20000
+
+typedef struct {
+    kg_mpmc_queue_t* q;
+    isize            id;
+    isize            sum;
+} test_mpmc_queue_task_st_;
+
+void* test_mpmc_queue_producer_(void* arg) {
+    test_mpmc_queue_task_st_* st = kg_cast(test_mpmc_queue_task_st_*)arg;
+    for (isize i = 0; i < TEST_MPMC_ITER; i++) {
+        isize v = st->id * TEST_MPMC_ITER + i;
+        kg_mpmc_queue_enqueue(st->q, &v);
+    }
+    return null;
+}
+
+void* test_mpmc_queue_consumer_(void* arg) {
+    test_mpmc_queue_task_st_* st = kg_cast(test_mpmc_queue_task_st_*)arg;
+    for (isize i = 0; i < TEST_MPMC_ITER; i++) {
+        isize v;
+        kg_mpmc_queue_deque(st->q, &v);
+        st->sum += v;
+    }
+    return null;
+}
+
+void test_mpmc_queue_threads() {
+    kg_allocator_t allocator = kg_allocator_default();
+    kg_mpmc_queue_t q;
+    kgt_expect_true(kg_mpmc_queue_create(&q, &allocator, kg_sizeof(isize), 16));
+    kg_thread_t producers[TEST_MPMC_THREADS_LEN];
+    kg_thread_t consumers[TEST_MPMC_THREADS_LEN];
+    test_mpmc_queue_task_st_ producer_sts[TEST_MPMC_THREADS_LEN];
+    test_mpmc_queue_task_st_ consumer_sts[TEST_MPMC_THREADS_LEN];
+    for (isize i = 0; i < TEST_MPMC_THREADS_LEN; i++) {
+        consumer_sts[i] = (test_mpmc_queue_task_st_){.q = &q, .id = i};
+        kgt_expect_true(kg_thread_create(&consumers[i], test_mpmc_queue_consumer_, &consumer_sts[i]));
+    }
+    for (isize i = 0; i < TEST_MPMC_THREADS_LEN; i++) {
+        producer_sts[i] = (test_mpmc_queue_task_st_){.q = &q, .id = i};
+        kgt_expect_true(kg_thread_create(&producers[i], test_mpmc_queue_producer_, &producer_sts[i]));
+    }
+    isize sum = 0;
+    for (isize i = 0; i < TEST_MPMC_THREADS_LEN; i++) {
+        kgt_expect_true(kg_thread_join(&producers[i]));
+        kgt_expect_true(kg_thread_join(&consumers[i]));
+        sum += consumer_sts[i].sum;
+    }
+    isize n = TEST_MPMC_THREADS_LEN * TEST_MPMC_ITER;
+    kgt_expect_eq(sum, n * (n - 1) / 2);
+    kgt_expect_eq(kg_mpmc_queue_len(&q), 0);
+    kg_mpmc_queue_destroy(&q);
+}
+
+void test_spsc_ring() {
+    kg_allocator_t allocator = kg_allocator_default();
+    kg_spsc_ring_t r;
+    kgt_expect_false(kg_spsc_ring_create(&r, &allocator, kg_sizeof(i32), 12));
+    kgt_expect_true(kg_spsc_ring_create(&r, &allocator, kg_sizeof(i32), 8));
+    i32 in[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    i32 out[8] = {0};
+    kgt_expect_eq(kg_spsc_ring_push(&r, in, 5), 5);
+    kgt_expect_eq(kg_spsc_ring_pop(&r, out, 3), 3);
+    kgt_expect_eq(out[2], 2);
+    kgt_expect_eq(kg_spsc_ring_push(&r, in, 8), 6);
+    kgt_expect_eq(kg_spsc_ring_len(&r), 8);
+    kgt_expect_eq(kg_spsc_ring_pop(&r, out, 8), 8);
+    kgt_expect_eq(out[0], 3);
+    kgt_expect_eq(out[1], 4);
+    for (isize i = 0; i < 6; i++) {
+        kgt_expect_eq(out[2 + i], i);
+    }
+    kgt_expect_eq(kg_spsc_ring_pop(&r, out, 1), 0);
+
+    isize n = 8;
+    i32* span = kg_spsc_ring_write_acquire(&r, &n);
+    kgt_expect_not_null(span);
+    kgt_expect_eq(n, 5);
+    for (isize i = 0; i < n; i++) {
+        span[i] = 100 + i;
+    }
+    kg_spsc_ring_write_commit(&r, n);
+    n = 8;
+    const i32* read_span = kg_spsc_ring_read_acquire(&r, &n);
+    kgt_expect_eq(n, 5);
+    kgt_expect_eq(read_span[4], 104);
+    kg_spsc_ring_read_commit(&r, 2);
+    kgt_expect_eq(kg_spsc_ring_len(&r), 3);
+    kg_spsc_ring_destroy(&r);
+    kgt_expect_null(r.ptr);
+}
+
+#define TEST_SPSC_ITER 200000
+
+void* test_spsc_ring_producer_(void* arg) {
+    kg_spsc_ring_t* r = kg_cast(kg_spsc_ring_t*)arg;
+    isize next = 0;
+    while (next < TEST_SPSC_ITER) {
+        isize n = kg_min(TEST_SPSC_ITER - next, 7);
+        isize* span = kg_spsc_ring_write_acquire(r, &n);
+        for (isize i = 0; i < n; i++) {
+            span[i] = next++;
+        }
+        if (n > 0) {
+            kg_spsc_ring_write_commit(r, n);
+        } else {
+            kg_thread_yield();
+        }
+    }
+    return null;
+}
+
+void test_spsc_ring_threads() {
+    kg_allocator_t allocator = kg_allocator_default();
+    kg_spsc_ring_t r;
+    kgt_expect_true(kg_spsc_ring_create(&r, &allocator, kg_sizeof(isize), 64));
+    kg_thread_t producer;
+    kgt_expect_true(kg_thread_create(&producer, test_spsc_ring_producer_, &r));
+    isize expected = 0;
+    b32 in_order = true;
+    isize buf[16];
+    while (expected < TEST_SPSC_ITER) {
+        isize n = kg_spsc_ring_pop(&r, buf, 16);
+        if (n == 0) {
+            kg_thread_yield();
+        }
+        for (isize i = 0; i < n; i++) {
+            in_order &= buf[i] == expected++;
+        }
+    }
+    kgt_expect_true(kg_thread_join(&producer));
+    kgt_expect_true(in_order);
+    kgt_expect_eq(kg_spsc_ring_len(&r), 0);
+    kg_spsc_ring_destroy(&r);
+}
+
+void* test_allocator_tracking_task_(void* arg) {
+    kg_allocator_t* allocator = kg_cast(kg_allocator_t*)arg;
+    for (isize i = 0; i < 1000; i++) {
+        void* mem = kg_allocator_alloc(allocator, 100);
+        mem = kg_allocator_resize(allocator, mem, 100, 200);
+        kg_allocator_free(allocator, mem, 200);
+    }
+    return null;
+}
+
+void test_allocator_tracking_quiet() {
+    kg_allocator_t backing_allocator = kg_allocator_default();
+    kg_allocator_tracking_context_t ctx = {
+        .name             = "quiet",
+        .parent_allocator = &backing_allocator,
+        .quiet            = true,
+    };
+    kg_allocator_t allocator = kg_allocator_tracking(&ctx);
+
+    void* a = kg_allocator_alloc(&allocator, 16);
+    void* b = kg_allocator_alloc(&allocator, 1000);
+    kg_allocator_free(&allocator, a, 16);
+    kg_allocator_free(&allocator, b, 1000);
+    kg_allocator_tracking_snapshot_t snapshot = kg_allocator_tracking_snapshot(&ctx);
+    kgt_expect_eq(snapshot.peak_allocated, 1016);
+    kgt_expect_eq(snapshot.current_allocated, 0);
+    kgt_expect_eq(snapshot.size_histogram[kg_allocator_tracking_histogram_index(16)], 1);
+    kgt_expect_eq(snapshot.size_histogram[kg_allocator_tracking_histogram_index(1000)], 1);
+    kgt_expect_eq(kg_allocator_tracking_histogram_index(16), 0);
+    kgt_expect_eq(kg_allocator_tracking_histogram_index(17), 1);
+    kgt_expect_eq(kg_allocator_tracking_histogram_index(1024), 6);
+    kgt_expect_eq(kg_allocator_tracking_histogram_index(ISIZE_MAX), KG_ALLOCATOR_TRACKING_HISTOGRAM_LEN - 1);
+
+    kg_pool_t p;
+    isize n = 8;
+    kgt_expect_true(kg_pool_create(&p, &backing_allocator, n));
+    for (isize i = 0; i < n; i++) {
+        kgt_expect_true(kg_pool_add_task(&p, test_allocator_tracking_task_, &allocator));
+    }
+    kgt_expect_true(kg_pool_join(&p));
+    kg_pool_destroy(&p);
+
+    snapshot = kg_allocator_tracking_snapshot(&ctx);
+    kgt_expect_eq(snapshot.alloc_count, 2 + n * 1000);
+    kgt_expect_eq(snapshot.resize_count, n * 1000);
+    kgt_expect_eq(snapshot.free_count, 2 + n * 1000);
+    kgt_expect_eq(snapshot.current_allocated, 0);
+    kgt_expect_eq(snapshot.total_allocated, snapshot.total_freed);
+    kgt_expect_gte(snapshot.peak_allocated, 1016);
+}
+
 void test_quicksort() {
     isize len = 7;
     isize values[7]      = {7,4,1,2,3,5,6};
@@ -515,6 +1614,222 @@ void test_quicksort() {
     }
 }
 
+typedef struct {
+    u32 key;
+    u32 order;
+} test_sort_pair_t;
+
+#define test_sort_pair_less_(a, b) ((a).key > (b).key)
+KG_SORT_TYPEDEF(test_sort_pair_t, test_pair_desc, test_sort_pair_less_)
+
+void test_sort() {
+    kg_allocator_t allocator = kg_allocator_default();
+    isize n = 5000;
+    i64* values = kg_allocator_alloc_array(&allocator, i64, n);
+    for (isize kind = 0; kind < 5; kind++) {
+        for (isize i = 0; i < n; i++) {
+            switch (kind) {
+                case 0: values[i] = kg_cast(i64)kg_hash_u64(i); break;
+                case 1: values[i] = i; break;
+                case 2: values[i] = n - i; break;
+                case 3: values[i] = kg_hash_u64(i) % 4; break;
+                case 4: values[i] = i % 2 == 0 ? i : n - i; break;
+            }
+        }
+        kg_sort_i64(values, n);
+        kgt_expect_true(kg_sort_i64_is_sorted(values, n));
+    }
+    for (isize i = 0; i < n; i++) {
+        values[i] = kg_hash_u64(i) % 8;
+    }
+    kg_quicksort(values, 0, n, kg_sizeof(i64), kg_i64_compare);
+    kgt_expect_true(kg_sort_i64_is_sorted(values, n));
+    i64 small[3] = {3, -1, 2};
+    kg_sort_i64(small, 0);
+    kgt_expect_eq(small[0], 3);
+    kg_sort_i64(small, 3);
+    kgt_expect_eq(small[0], -1);
+    kgt_expect_eq(small[2], 3);
+    for (isize i = 0; i < n; i++) {
+        values[i] = kg_cast(i64)kg_hash_u64(i);
+    }
+    kg_sort_i64_heap(values, n);
+    kgt_expect_true(kg_sort_i64_is_sorted(values, n));
+    kg_allocator_free(&allocator, values, n * kg_sizeof(i64));
+
+    test_sort_pair_t pairs[300];
+    for (isize i = 0; i < 300; i++) {
+        pairs[i] = (test_sort_pair_t){.key = kg_cast(u32)(kg_hash_u64(i) % 50), .order = kg_cast(u32)i};
+    }
+    kg_sort_test_pair_desc(pairs, 300);
+    kgt_expect_true(kg_sort_test_pair_desc_is_sorted(pairs, 300));
+    kgt_expect_true((pairs[0].key >= pairs[299].key));
+}
+
+void test_radix_sort() {
+    kg_allocator_t allocator = kg_allocator_default();
+    isize n = 3000;
+    i64* ikeys = kg_allocator_alloc_array(&allocator, i64, n);
+    f64* fkeys = kg_allocator_alloc_array(&allocator, f64, n);
+    u32* ukeys = kg_allocator_alloc_array(&allocator, u32, n);
+    isize* values = kg_allocator_alloc_array(&allocator, isize, n);
+    for (isize i = 0; i < n; i++) {
+        ikeys[i] = kg_cast(i64)kg_hash_u64(i) >> 3;
+        fkeys[i] = kg_cast(f64)kg_cast(i64)(kg_hash_u64(i) % 2001) / 8.0 - 125.0;
+        ukeys[i] = kg_cast(u32)(kg_hash_u64(i) % 100) << 8;
+        values[i] = i;
+    }
+    fkeys[0] = -0.0;
+    fkeys[1] = 1e300;
+    fkeys[2] = -1e300;
+    kgt_expect_true(kg_radix_sort_i64(ikeys, null, n, &allocator));
+    kgt_expect_true(kg_sort_i64_is_sorted(ikeys, n));
+    kgt_expect_true((ikeys[0] < 0));
+    kgt_expect_true(kg_radix_sort_f64(fkeys, null, n, &allocator));
+    kgt_expect_true(kg_sort_f64_is_sorted(fkeys, n));
+    kgt_expect_eq(fkeys[0], -1e300);
+    kgt_expect_eq(fkeys[n - 1], 1e300);
+
+    kgt_expect_true(kg_radix_sort_u32(ukeys, values, n, &allocator));
+    kgt_expect_true(kg_sort_u32_is_sorted(ukeys, n));
+    b32 stable = true;
+    for (isize i = 0; i < n; i++) {
+        stable &= ukeys[i] == (kg_cast(u32)(kg_hash_u64(values[i]) % 100) << 8);
+        if (i > 0 && ukeys[i] == ukeys[i - 1]) {
+            stable &= values[i] > values[i - 1];
+        }
+    }
+    kgt_expect_true(stable);
+
+    i32 small[5] = {3, -7, 0, -1, 2147483647};
+    f32 fsmall[4] = {0.5f, -2.0f, -0.25f, 3.0f};
+    kgt_expect_true(kg_radix_sort_i32(small, null, 5, &allocator));
+    kgt_expect_true(kg_sort_i32_is_sorted(small, 5));
+    kgt_expect_true(kg_radix_sort_f32(fsmall, null, 4, &allocator));
+    kgt_expect_eq(fsmall[0], -2.0f);
+    kgt_expect_eq(fsmall[3], 3.0f);
+
+    kg_allocator_tracking_context_t ctx = {
+        .name             = "radix",
+        .parent_allocator = &allocator,
+        .quiet            = true,
+    };
+    kg_allocator_t tracking_allocator = kg_allocator_tracking(&ctx);
+    u64 same[4] = {7, 7, 7, 7};
+    kgt_expect_true(kg_radix_sort_u64(same, null, 4, &tracking_allocator));
+    kgt_expect_eq(ctx.alloc_count, 0);
+    kgt_expect_eq(same[3], 7);
+
+    kg_allocator_free(&allocator, ikeys, n * kg_sizeof(i64));
+    kg_allocator_free(&allocator, fkeys, n * kg_sizeof(f64));
+    kg_allocator_free(&allocator, ukeys, n * kg_sizeof(u32));
+    kg_allocator_free(&allocator, values, n * kg_sizeof(isize));
+}
+
+kg_static isize test_stable_sort_comparisons_ = 0;
+#define test_stable_sort_pair_less_(a, b) (test_stable_sort_comparisons_++, (a).key < (b).key)
+KG_STABLE_SORT_TYPEDEF(test_sort_pair_t, test_pair, test_stable_sort_pair_less_)
+
+void test_stable_sort() {
+    kg_allocator_t allocator = kg_allocator_default();
+    isize lens[] = {0, 1, 7, 63, 64, 65, 1000, 54321};
+    isize n_max = 54321;
+    test_sort_pair_t* pairs = kg_allocator_alloc_array(&allocator, test_sort_pair_t, n_max);
+    for (isize l = 0; l < kg_sizeof(lens) / kg_sizeof(lens[0]); l++) {
+        isize n = lens[l];
+        for (isize kind = 0; kind < 4; kind++) {
+            for (isize i = 0; i < n; i++) {
+                u32 key = 0;
+                switch (kind) {
+                    case 0: key = kg_cast(u32)(kg_hash_u64(i) % 97); break;
+                    case 1: key = kg_cast(u32)(n - i) / 3; break;
+                    case 2: key = kg_cast(u32)(i / 50 % 2 == 0 ? i : n - i); break;
+                    case 3: key = kg_cast(u32)(i % 1000 == 0 ? n - i : i / 4); break;
+                }
+                pairs[i] = (test_sort_pair_t){.key = key, .order = kg_cast(u32)i};
+            }
+            kgt_expect_true(kg_stable_sort_test_pair(pairs, n, &allocator));
+            b32 stable = true;
+            for (isize i = 1; i < n; i++) {
+                stable &= pairs[i - 1].key < pairs[i].key || (pairs[i - 1].key == pairs[i].key && pairs[i - 1].order < pairs[i].order);
+            }
+            kgt_expect_true(stable);
+        }
+    }
+
+    isize n = 50000;
+    for (isize i = 0; i < n; i++) {
+        pairs[i] = (test_sort_pair_t){.key = kg_cast(u32)i, .order = kg_cast(u32)i};
+    }
+    for (isize i = 0; i + 1 < n; i += 5000) {
+        test_sort_pair_t t = pairs[i];
+        pairs[i] = pairs[i + 1];
+        pairs[i + 1] = t;
+    }
+    test_stable_sort_comparisons_ = 0;
+    kgt_expect_true(kg_stable_sort_test_pair(pairs, n, &allocator));
+    kgt_expect_true((test_stable_sort_comparisons_ < 3 * n));
+    for (isize i = 0; i < n; i++) {
+        kgt_expect_eq(pairs[i].key, i);
+    }
+    kg_allocator_free(&allocator, pairs, n_max * kg_sizeof(test_sort_pair_t));
+}
+
+KG_PARALLEL_SORT_TYPEDEF(i64, i64, kg_sort_less)
+KG_PARALLEL_SORT_TYPEDEF(test_sort_pair_t, test_pair_desc, test_sort_pair_less_)
+
+void test_parallel_sort() {
+    kg_allocator_t allocator = kg_allocator_default();
+    kg_pool_t p;
+    kgt_expect_true(kg_pool_create(&p, &allocator, 3));
+    isize n = 100003;
+    i64* values = kg_allocator_alloc_array(&allocator, i64, n);
+    for (isize i = 0; i < n; i++) {
+        values[i] = kg_cast(i64)kg_hash_u64(i);
+    }
+    kgt_expect_true(kg_parallel_sort_i64(&p, &allocator, values, n));
+    kgt_expect_true(kg_sort_i64_is_sorted(values, n));
+    for (isize i = 0; i < n; i++) {
+        values[i] = kg_cast(i64)(n - i);
+    }
+    kgt_expect_true(kg_parallel_sort_i64(&p, &allocator, values, n));
+    kgt_expect_eq(values[0], 1);
+    kgt_expect_eq(values[n - 1], n);
+
+    kg_arena_t arena;
+    kgt_expect_true(kg_arena_create(&arena, &allocator, 64));
+    kg_allocator_t small_allocator = kg_allocator_temp(&arena);
+    for (isize i = 0; i < n; i++) {
+        values[i] = kg_cast(i64)kg_hash_u64(i);
+    }
+    kgt_expect_false(kg_parallel_sort_i64(&p, &small_allocator, values, n));
+    kgt_expect_true(kg_sort_i64_is_sorted(values, n));
+    kg_arena_destroy(&arena);
+
+    kg_pool_t p5;
+    kgt_expect_true(kg_pool_create(&p5, &allocator, 5));
+    for (isize i = 0; i < n; i++) {
+        values[i] = kg_cast(i64)kg_hash_u64(i + n);
+    }
+    kgt_expect_true(kg_parallel_sort_i64(&p5, &allocator, values, n));
+    kgt_expect_true(kg_sort_i64_is_sorted(values, n));
+    kgt_expect_true(kg_pool_join(&p5));
+    kg_pool_destroy(&p5);
+    kg_allocator_free(&allocator, values, n * kg_sizeof(i64));
+
+    isize m = 40000;
+    test_sort_pair_t* pairs = kg_allocator_alloc_array(&allocator, test_sort_pair_t, m);
+    for (isize i = 0; i < m; i++) {
+        pairs[i] = (test_sort_pair_t){.key = kg_cast(u32)(kg_hash_u64(i) % 7), .order = kg_cast(u32)i};
+    }
+    kgt_expect_true(kg_parallel_sort_test_pair_desc(&p, &allocator, pairs, m));
+    kgt_expect_true(kg_sort_test_pair_desc_is_sorted(pairs, m));
+    kg_allocator_free(&allocator, pairs, m * kg_sizeof(test_sort_pair_t));
+
+    kgt_expect_true(kg_pool_join(&p));
+    kg_pool_destroy(&p);
+}
+
 void test_string_builder() {
     kg_allocator_t a = kg_allocator_default();
     kg_string_builder_t b;
@@ -589,6 +1904,47 @@ void test_string_builder() {
     kg_string_builder_destroy(&b);
 }
 
+void test_chunk_builder() {
+    kg_allocator_t allocator = kg_allocator_default();
+    kg_chunk_builder_t b;
+    kgt_expect_true(kg_chunk_builder_create(&b, &allocator, 16));
+    kgt_expect_true(kg_chunk_builder_write_cstr(&b, "hello "));
+    kgt_expect_true(kg_chunk_builder_write_fmt(&b, "%s %i", "world", 42));
+    kgt_expect_eq(kg_chunk_builder_chunks_len(&b), 1);
+    const char* first = b.chunks.ptr[0];
+    kg_string_t s = kg_chunk_builder_detach(&b);
+    kgt_expect_true((s == first));
+    kgt_expect_cstr_eq(s, "hello world 42");
+    kgt_expect_eq(kg_string_len(s), 14);
+    kgt_expect_eq(kg_chunk_builder_len(&b), 0);
+    kg_string_destroy(s);
+
+    for (isize i = 0; i < 300; i++) {
+        kgt_expect_true(kg_chunk_builder_write_fmt(&b, "%03li,", i));
+    }
+    kgt_expect_true(kg_chunk_builder_write_str(&b, kg_str_create("end")));
+    kgt_expect_eq(kg_chunk_builder_len(&b), 1203);
+    kgt_expect_true((kg_chunk_builder_chunks_len(&b) > KG_CHUNK_BUILDER_IOV_LEN));
+
+    char path[] = "/tmp/kg_chunk_builder_XXXXXX";
+    i32 fd = mkstemp(path);
+    kgt_expect_true((fd >= 0));
+    kgt_expect_eq(kg_chunk_builder_write_fd(&b, fd), 1203);
+    close(fd);
+    kg_file_content_t content = kg_file_content_read(&allocator, path);
+    unlink(path);
+
+    s = kg_chunk_builder_detach(&b);
+    kgt_expect_eq(kg_string_len(s), 1203);
+    kgt_expect_mem_eq(s, "000,001,002,", 12);
+    kgt_expect_cstr_eq(s + 1196, "299,end");
+    kgt_expect_mem_eq(content.cstr, s, 1203);
+    kgt_expect_eq(kg_chunk_builder_chunks_len(&b), 0);
+    kg_string_destroy(s);
+    kg_file_content_destroy(&content);
+    kg_chunk_builder_destroy(&b);
+}
+
 void test_uft8() {
     rune r_in = 0x015b;
     u8 buf[4] = {0};
@@ -697,6 +2053,9 @@ void test_string_set() {
     kgt_expect_cstr_eq(s, "");
 }
 
+void test_allocator_profile();
+void test_allocator_profile_entry_site();
+
 int main() {
     kgt_t t;
     kgt_create(&t);
@@ -707,6 +2066,13 @@ int main() {
         kgt_register(test_mem_swap),
         kgt_register(test_darray),
         kgt_register(test_darray2),
+        kgt_register(test_darray2_bulk),
+        kgt_register(test_soa),
+        kgt_register(test_small_darray),
+        kgt_register(test_map),
+        kgt_register(test_map_erase_reuses_slots),
+        kgt_register(test_map_str),
+        kgt_register(test_interner),
         kgt_register(test_file_read_contant),
         kgt_register(test_string_from_cstr),
         kgt_register(test_string_from_str),
@@ -736,10 +2102,39 @@ int main() {
         kgt_register(test_format),
         kgt_register(test_parse),
         kgt_register(test_allocator_temp),
+        kgt_register(test_arena_chained),
+        kgt_register(test_arena_virtual),
+        kgt_register(test_arena_alloc_align),
+        kgt_register(test_arena_temp),
+        kgt_register(test_arena_reset),
+        kgt_register(test_allocator_alloc_uninit),
+        kgt_register(test_allocator_batch),
+        kgt_register(test_allocator_temp_resize),
+        kgt_register(test_object_pool),
+        kgt_register(test_heap_class_index),
+        kgt_register(test_heap),
+        kgt_register(test_allocator_mmap),
         kgt_register(test_queue),
+        kgt_register(test_queue_wraparound),
+        kgt_register(test_queue_typed),
         kgt_register(test_pool),
+        kgt_register(test_thread_heap),
+        kgt_register(test_thread_heap_tls_eviction),
+        kgt_register(test_thread_interner),
+        kgt_register(test_mpmc_queue),
+        kgt_register(test_mpmc_queue_threads),
+        kgt_register(test_spsc_ring),
+        kgt_register(test_spsc_ring_threads),
+        kgt_register(test_parallel_sort),
+        kgt_register(test_allocator_tracking_quiet),
+        kgt_register(test_allocator_profile),
+        kgt_register(test_allocator_profile_entry_site),
         kgt_register(test_quicksort),
+        kgt_register(test_sort),
+        kgt_register(test_radix_sort),
+        kgt_register(test_stable_sort),
         kgt_register(test_string_builder),
+        kgt_register(test_chunk_builder),
         kgt_register(test_uft8),
         kgt_register(test_utf8_decode_rune),
         kgt_register(test_uft8_encode_rune),
@@ -0,0 +1,89 @@
+#define KG_ALLOCATOR_PROFILE
+#define KG_TESTER
+#include "kg.h"
+
+void test_allocator_profile() {
+    kg_allocator_t backing_allocator = kg_allocator_default();
+    kg_allocator_profile_context_t* ctx = kg_allocator_alloc_array(&backing_allocator, kg_allocator_profile_context_t, 1);
+    ctx->parent_allocator = &backing_allocator;
+    kg_allocator_t allocator = kg_allocator_profile(ctx);
+
+    for (isize i = 0; i < 10; i++) {
+        void* mem = kg_allocator_alloc(&allocator, 32);
+        kgt_expect_not_null(mem);
+        kg_allocator_free(&allocator, mem, 32);
+    }
+    isize leak_line = __LINE__ + 1;
+    void* leak = kg_allocator_alloc(&allocator, 100);
+    kg_string_t s = kg_string_from_cstr(&allocator, "hello");
+    s = kg_string_append_cstr(s, " world, this grows the string past its capacity");
+    kgt_expect_true(kg_string_is_equal_cstr(s, "hello world, this grows the string past its capacity"));
+    kg_string_destroy(s);
+
+    kg_allocator_profile_site_t sites[4];
+    isize sites_len = kg_allocator_profile_sites(ctx, sites, 4, KG_ALLOCATOR_PROFILE_SORT_COUNT);
+    kgt_expect_eq(sites_len, 4);
+    kgt_expect_eq(sites[0].alloc_count, 10);
+    kgt_expect_eq(sites[0].free_count, 10);
+    kgt_expect_eq(sites[0].total_allocated, 320);
+    kgt_expect_eq(sites[0].live_count, 0);
+
+    sites_len = kg_allocator_profile_sites(ctx, sites, 4, KG_ALLOCATOR_PROFILE_SORT_LIVE);
+    kgt_expect_eq(sites_len, 1);
+    kgt_expect_eq(kg_cstr_compare(sites[0].file, __FILE__), 0);
+    kgt_expect_eq(sites[0].line, leak_line);
+    kgt_expect_eq(sites[0].live_count, 1);
+    kgt_expect_eq(sites[0].live_allocated, 100);
+
+    kg_allocator_free(&allocator, leak, 100);
+    sites_len = kg_allocator_profile_sites(ctx, sites, 4, KG_ALLOCATOR_PROFILE_SORT_LIVE);
+    kgt_expect_eq(sites_len, 0);
+    kgt_expect_eq(ctx->dropped_count, 0);
+
+    kg_allocator_free(&backing_allocator, ctx, kg_sizeof(kg_allocator_profile_context_t));
+}
+
+void test_allocator_profile_entry_site() {
+    kg_allocator_t backing_allocator = kg_allocator_default();
+    kg_allocator_profile_context_t* ctx = kg_allocator_alloc_array(&backing_allocator, kg_allocator_profile_context_t, 1);
+    ctx->parent_allocator = &backing_allocator;
+    kg_allocator_t allocator = kg_allocator_profile(ctx);
+
+    isize fmt_line = __LINE__ + 1;
+    kg_string_t s = kg_string_from_fmt(&allocator, "%s %li", "site", 42l);
+    kgt_expect_true(kg_string_is_equal_cstr(s, "site 42"));
+    isize* d = kg_darray_create(&allocator, isize, 1);
+    isize append_line = __LINE__ + 2;
+    for (isize i = 0; i < 100; i++) {
+        kg_darray_append(d, i);
+    }
+
+    kg_allocator_profile_site_t sites[4];
+    isize sites_len = kg_allocator_profile_sites(ctx, sites, 4, KG_ALLOCATOR_PROFILE_SORT_LIVE);
+    kgt_expect_eq(sites_len, 2);
+    for (isize i = 0; i < sites_len; i++) {
+        kgt_expect_eq(kg_cstr_compare(sites[i].file, __FILE__), 0);
+        kgt_expect_true((sites[i].line == fmt_line || sites[i].line == append_line));
+    }
+    kgt_expect_eq(ctx->dropped_count, 0);
+
+    void* mem = kg_allocator_alloc(&allocator, 16);
+    sites_len = kg_allocator_profile_sites(ctx, sites, 4, KG_ALLOCATOR_PROFILE_SORT_LIVE);
+    kgt_expect_eq(sites_len, 3);
+    kg_allocator_free(&allocator, mem, 16);
+
+    void* ptrs[100];
+    kgt_expect_true(kg_allocator_alloc_batch(&allocator, 8, 100, ptrs));
+    void* first = ptrs[0];
+    kg_allocator_free(&allocator, ptrs[1], 8);
+    ptrs[1] = null;
+    kg_allocator_free_batch(&allocator, ptrs, 100, 8);
+    kgt_expect_eq(ptrs[0], first);
+    kgt_expect_null(ptrs[1]);
+
+    kg_darray_destroy(d);
+    kg_string_destroy(s);
+    sites_len = kg_allocator_profile_sites(ctx, sites, 4, KG_ALLOCATOR_PROFILE_SORT_LIVE);
+    kgt_expect_eq(sites_len, 0);
+    kg_allocator_free(&backing_allocator, ctx, kg_sizeof(kg_allocator_profile_context_t));
+}